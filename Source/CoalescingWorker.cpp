@@ -0,0 +1,40 @@
+#include "CoalescingWorker.h"
+
+CoalescingWorker::CoalescingWorker(const juce::String& threadName, std::function<void()> jobToRun,
+                                   int settleTimeMs)
+    : juce::Thread(threadName),
+      job(std::move(jobToRun)),
+      settleTime(settleTimeMs)
+{
+    startThread();
+}
+
+CoalescingWorker::~CoalescingWorker()
+{
+    stopThread(2000);
+}
+
+void CoalescingWorker::request() noexcept
+{
+    pending.store(true, std::memory_order_release);
+}
+
+void CoalescingWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        // stopThread() still wakes this wait early
+        wait(settleTime);
+
+        if (!pending.exchange(false, std::memory_order_acq_rel))
+            continue;
+
+        // Keep waiting while requests are still arriving
+        do
+            wait(settleTime);
+        while (!threadShouldExit() && pending.exchange(false, std::memory_order_acq_rel));
+
+        if (!threadShouldExit())
+            job();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief Background thread that runs one job per burst of requests
+ *
+ * request() only sets an atomic flag, which the worker polls once per settle
+ * time; signalling the thread would take a lock, and requests may come from
+ * the audio thread. The worker waits until requests have stopped arriving
+ * for the settle time, then runs the job once, so a slider drag or an
+ * automation ramp costs a single run rather than one per change.
+ */
+class CoalescingWorker : private juce::Thread {
+public:
+    static constexpr int kDefaultSettleTimeMs = 50;
+
+    CoalescingWorker(const juce::String& threadName, std::function<void()> jobToRun,
+                     int settleTimeMs = kDefaultSettleTimeMs);
+    ~CoalescingWorker() override;
+
+    // Lock-free, so safe on any thread
+    void request() noexcept;
+
+private:
+    void run() override;
+
+    std::function<void()> job;
+    const int settleTime;
+    std::atomic<bool> pending{false};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CoalescingWorker)
+};
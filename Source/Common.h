@@ -18,6 +18,61 @@ enum class NoteDivision {
     Sixteenth = 16
 };
 
+// Multi-track layout
+namespace TrackConstants {
+    constexpr int NUM_TRACKS = 16;
+    constexpr int MAIN_TRACK = 0;    // The track shown and edited in the grid
+}
+
+// Per-track playback settings
+struct TrackSettings {
+    NoteDivision division{NoteDivision::Sixteenth};
+    int midiChannel{1};              // 1-16
+    bool muted{false};
+    bool soloed{false};
+};
+
+// Bit scanning for the active-voice and active-track masks
+namespace BitUtils {
+    inline int countTrailingZeros(juce::uint64 value) noexcept {
+       #if JUCE_MSVC
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+       #else
+        return __builtin_ctzll(value);
+       #endif
+    }
+}
+
+// Integer helpers for positions that may fall before an anchor
+namespace MathUtils {
+    // Division rounding towards negative infinity
+    inline juce::int64 floorDivide(juce::int64 numerator, juce::int64 denominator) noexcept {
+        const auto quotient = numerator / denominator;
+        return (numerator % denominator != 0 && (numerator < 0) != (denominator < 0)) ? quotient - 1 : quotient;
+    }
+}
+
+// Where the sequencer takes its step clock from
+enum class TransportSource {
+    Internal,     // Free-running clock, started and stopped from the editor
+    Host          // Locked to the host's playhead position, tempo and play state
+};
+
+// Internal synth oscillator implementation
+enum class OscillatorMode {
+    Polynomial,   // Vectorised parabolic sine approximation
+    Wavetable     // Interpolated lookup into a band-limited table
+};
+
+// Which voice the internal synth cuts off when every voice is busy
+enum class VoiceStealingPolicy {
+    Oldest,
+    Quietest,
+    SameNote      // Retrigger the voice already playing the note, else oldest
+};
+
 // Rhythm patterns
 enum class RhythmPattern {
     Regular,
@@ -94,6 +149,31 @@ namespace EnumToString {
         }
     }
 
+    inline std::string toString(TransportSource source) {
+        switch (source) {
+            case TransportSource::Internal: return "Internal";
+            case TransportSource::Host: return "Host";
+            default: return "Unknown";
+        }
+    }
+
+    inline std::string toString(OscillatorMode mode) {
+        switch (mode) {
+            case OscillatorMode::Polynomial: return "Polynomial";
+            case OscillatorMode::Wavetable: return "Wavetable";
+            default: return "Unknown";
+        }
+    }
+
+    inline std::string toString(VoiceStealingPolicy policy) {
+        switch (policy) {
+            case VoiceStealingPolicy::Oldest: return "Oldest";
+            case VoiceStealingPolicy::Quietest: return "Quietest";
+            case VoiceStealingPolicy::SameNote: return "Same Note";
+            default: return "Unknown";
+        }
+    }
+
     inline std::string toString(RhythmPattern pattern) {
         switch (pattern) {
             case RhythmPattern::Regular: return "Regular";
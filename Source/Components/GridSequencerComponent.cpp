@@ -43,19 +43,7 @@ GridSequencerComponent::GridSequencerComponent(GrooveSequencerAudioProcessor& p)
 {
     setOpaque(true);
     
-    // Initialize grid from processor pattern
-    const auto& pattern = processor.getPattern();
-    for (const auto& note : pattern.notes) {
-        int col = static_cast<int>(note.startTime / pattern.gridSize);
-        int row = note.pitch - 60;  // Assuming base pitch is 60 (middle C)
-        
-        if (row >= 0 && row < kRows && col >= 0 && col < kCols) {
-            grid[row][col].active = note.active;
-            grid[row][col].velocity = note.velocity;
-            grid[row][col].accent = note.accent;
-            grid[row][col].isStaccato = note.isStaccato;
-        }
-    }
+    refreshCells();
     
     startTimerHz(60);
 }
@@ -231,13 +219,37 @@ void GridSequencerComponent::handleCellInteraction(int row, int col, const juce:
         cell.active = !cell.active;
     }
     
-    // Update processor pattern - use global velocity from processor
-    processor.updateGridCell(row, col, cell.active, processor.getVelocityScale() * 127.0f, cell.accent, cell.isStaccato);
+    // Update processor pattern; the cell's velocity is already 0-127 like the pattern's
+    processor.updateGridCell(row, col, cell.active, cell.velocity, cell.accent, cell.isStaccato);
     repaint();
 }
 
+void GridSequencerComponent::refreshCells()
+{
+    // Taken from a locked copy, so a worker editing the pattern can't tear it
+    shownPatternVersion = processor.getPatternVersion();
+    const auto pattern = processor.getPattern();
+    
+    for (auto& row : grid)
+        std::fill(row.begin(), row.end(), GridCell{});
+    
+    for (const auto& note : pattern.getNotes()) {
+        const int col = static_cast<int>(note.startTime / pattern.getGridSize());
+        const int row = note.pitch - basePitch;
+        
+        if (isPositionValid(row, col))
+            grid[static_cast<size_t>(row)][static_cast<size_t>(col)].updateState(note.active, note.velocity, note.accent, note.isStaccato);
+    }
+}
+
 void GridSequencerComponent::timerCallback()
 {
+    // Undo, redo, loads and generated patterns all change the pattern behind the grid's back
+    if (processor.getPatternVersion() != shownPatternVersion) {
+        refreshCells();
+        repaint();
+    }
+    
     const juce::ScopedLock sl(processor.getCallbackLock());
     if (processor.isPlaying()) {
         currentStep = processor.getCurrentStep();
@@ -303,7 +315,7 @@ void GridSequencerComponent::setBasePitch(int midiNote)
             {
                 if (grid[row][col].active)
                 {
-                    processor.updateGridCell(row, col, true, grid[row][col].velocity / 127.0f,
+                    processor.updateGridCell(row, col, true, grid[row][col].velocity,
                                           grid[row][col].accent, grid[row][col].isStaccato);
                 }
             }
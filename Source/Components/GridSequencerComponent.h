@@ -69,6 +69,10 @@ private:
     } dragState;
     
     int currentStep = 0;
+    juce::uint32 shownPatternVersion = 0;
+    
+    // Rebuilds the cells from the processor's main pattern
+    void refreshCells();
     
     // Mouse interaction
     void handleCellInteraction(int row, int col, const juce::ModifierKeys& mods, float dragDelta = 0.0f);
@@ -1,9 +1,62 @@
 #include "PatternBrowserComponent.h"
+#include "../PatternJsonReader.h"
 #include <juce_data_structures/juce_data_structures.h>
 
 namespace {
-    constexpr const char* kPatternFileExtension = ".pattern";
+    constexpr const char* kPatternFileExtension = ".pattern";   // JSON, for import and export
     constexpr const char* kDefaultPatternsDir = "GrooveSequencer/Patterns";
+    constexpr const char* kLibraryPackName = "Library";
+
+    // Loose user files are opened one by one at startup, so past this many they are packed
+    constexpr int kLooseFilesBeforePacking = 32;
+
+    // Decodes an entry straight from the mapped file where possible
+    template <typename Reader>
+    bool readEntryFromFile(const juce::File& file, PatternEntry& entry, ValidationReport& report, Reader&& read)
+    {
+        return PatternFormat::readFileData(file, [&](const void* data, size_t size) {
+            return read(data, size, entry, report);
+        });
+    }
+    
+    // The editor's Save writes a bare pattern, which starts with the same magic
+    // as an entry; one that fills the file is listed as a user pattern named
+    // after the file
+    bool readBinaryEntry(const juce::File& file, const void* data, size_t size,
+                         PatternEntry& entry, ValidationReport& report)
+    {
+        if (PatternEntry::tryFromBinary(data, size, entry, report))
+            return true;
+        if (report.error != ValidationError::Truncated)
+            return false;
+        
+        PatternEntry bare;
+        ValidationReport patternReport;
+        size_t bytesUsed = 0;
+        if (!Pattern::tryFromBinary(data, size, bare.pattern, patternReport, &bytesUsed) || bytesUsed != size)
+            return false;
+        
+        bare.name = file.getFileNameWithoutExtension();
+        bare.type = "User";
+        bare.style = "Custom";
+        bare.modified = file.getLastModificationTime();
+        if (!bare.validate()) {
+            report.error = ValidationError::InvalidMetadata;
+            return false;
+        }
+        
+        report = {};
+        entry = std::move(bare);
+        return true;
+    }
+    
+    bool writePackFile(const PatternPack::Builder& builder, const juce::File& target)
+    {
+        juce::FileOutputStream out(target);
+        const bool written = out.openedOk() && builder.write(out);
+        out.flush();
+        return written && !out.getStatus().failed();
+    }
 }
 
 enum class TableColumns
@@ -21,6 +74,7 @@ PatternBrowserComponent::PatternBrowserComponent()
     loadButton = std::make_unique<juce::TextButton>("Load");
     saveButton = std::make_unique<juce::TextButton>("Save");
     deleteButton = std::make_unique<juce::TextButton>("Delete");
+    exportButton = std::make_unique<juce::TextButton>("Export");
     searchBox = std::make_unique<juce::TextEditor>();
     styleFilter = std::make_unique<juce::ComboBox>();
     
@@ -29,6 +83,7 @@ PatternBrowserComponent::PatternBrowserComponent()
     addAndMakeVisible(loadButton.get());
     addAndMakeVisible(saveButton.get());
     addAndMakeVisible(deleteButton.get());
+    addAndMakeVisible(exportButton.get());
     addAndMakeVisible(searchBox.get());
     addAndMakeVisible(styleFilter.get());
     
@@ -47,6 +102,9 @@ PatternBrowserComponent::PatternBrowserComponent()
         juce::Logger::writeToLog("Failed to create patterns directory: " + result.getErrorMessage());
     }
     
+    // Packs are rewritten on this thread; the swap happens back on the message thread
+    packWriteThread = std::make_unique<juce::ThreadPool>(1);
+    
     // Load patterns
     loadPresetPatterns();
     
@@ -63,6 +121,9 @@ PatternBrowserComponent::PatternBrowserComponent()
 
 PatternBrowserComponent::~PatternBrowserComponent()
 {
+    // A pack write in progress reads the open pack, so it is waited for in full
+    packWriteThread->removeAllJobs(true, -1);
+    packWriteThread.reset();
     patternList->removeMouseListener(this);
 }
 
@@ -88,6 +149,8 @@ void PatternBrowserComponent::resized()
     saveButton->setBounds(buttonArea.removeFromLeft(100));
     buttonArea.removeFromLeft(10);
     deleteButton->setBounds(buttonArea.removeFromLeft(100));
+    buttonArea.removeFromLeft(10);
+    exportButton->setBounds(buttonArea.removeFromLeft(100));
     
     // Pattern list takes remaining space
     bounds.removeFromTop(10);
@@ -108,11 +171,12 @@ void PatternBrowserComponent::initializeButtons()
 {
     loadButton->onClick = [this]() {
         auto selectedRow = patternList->getSelectedRow();
-        if (selectedRow >= 0 && selectedRow < filteredIndices.size())
+        PatternEntry entry;
+        if (selectedRow >= 0 && selectedRow < filteredIndices.size()
+            && readEntry(filteredIndices[selectedRow], entry))
         {
-            int actualIndex = filteredIndices[selectedRow];
             if (onPatternSelected)
-                onPatternSelected(patterns[actualIndex]->pattern);
+                onPatternSelected(entry.pattern);
         }
     };
     
@@ -123,6 +187,22 @@ void PatternBrowserComponent::initializeButtons()
     deleteButton->onClick = [this]() {
         deleteSelectedPattern();
     };
+    
+    exportButton->onClick = [this]() {
+        if (patternList->getSelectedRow() < 0)
+            return;
+        
+        fileChooser = std::make_unique<juce::FileChooser>("Export pattern", patternsDirectory,
+                                                          juce::String("*") + kPatternFileExtension);
+        fileChooser->launchAsync(juce::FileBrowserComponent::saveMode
+                                   | juce::FileBrowserComponent::canSelectFiles
+                                   | juce::FileBrowserComponent::warnAboutOverwriting,
+                                 [this](const juce::FileChooser& chooser) {
+            const auto file = chooser.getResult();
+            if (file != juce::File())
+                exportSelectedPattern(file.withFileExtension(kPatternFileExtension));
+        });
+    };
 }
 
 void PatternBrowserComponent::initializeFilters()
@@ -151,11 +231,22 @@ void PatternBrowserComponent::loadPresetPatterns()
     createLatinPatterns();
     createJazzPatterns();
     
-    // Load user patterns from directory
-    for (const auto& file : patternsDirectory.findChildFiles(juce::File::findFiles, false, "*.pattern"))
+    // A library of any size opens in constant time; loose files are newer saves
+    openLibraryPack();
+    
+    // Load user patterns from directory; a JSON file is only imported if it
+    // has not been saved in the binary format since
+    for (const auto& file : patternsDirectory.findChildFiles(juce::File::findFiles, false,
+                                                             juce::String("*") + PatternFormat::kFileExtension + ";*" + kPatternFileExtension))
     {
+        if (file.hasFileExtension(kPatternFileExtension)
+            && file.withFileExtension(PatternFormat::kFileExtension).existsAsFile())
+            continue;
+
         loadPatternFromFile(file);
     }
+    
+    packUserPatternsIfNeeded();
 }
 
 void PatternBrowserComponent::createBasicPatterns()
@@ -186,17 +277,20 @@ void PatternBrowserComponent::loadPatternFromFile(const juce::File& file)
     }
         
     try {
-        auto jsonText = file.loadFileAsString();
-        auto jsonVar = juce::JSON::fromString(jsonText);
+        // Bad files are common in a large library; skip them without throwing.
+        // JSON is streamed into the entry rather than built into a var tree
+        PatternEntry entry;
+        ValidationReport report;
+        const bool loaded = file.hasFileExtension(PatternFormat::kFileExtension)
+                              ? readEntryFromFile(file, entry, report,
+                                                  [&file](const void* data, size_t size, PatternEntry& result, ValidationReport& problems) {
+                                                      return readBinaryEntry(file, data, size, result, problems);
+                                                  })
+                              : readEntryFromFile(file, entry, report, PatternJsonReader::readEntry);
         
-        if (!jsonVar.isObject()) {
-            juce::Logger::writeToLog("Invalid JSON in pattern file: " + file.getFullPathName());
-            return;
-        }
-            
-        PatternEntry entry = PatternEntry::fromVar(jsonVar);
-        if (!entry.validate()) {
-            juce::Logger::writeToLog("Invalid pattern data in file: " + file.getFullPathName());
+        if (!loaded) {
+            juce::Logger::writeToLog("Invalid pattern data in file: " + file.getFullPathName()
+                                     + (report.isValid() ? juce::String() : " - " + report.describe()));
             return;
         }
 
@@ -224,6 +318,8 @@ void PatternBrowserComponent::saveCurrentPattern(const Pattern& pattern, const j
     // Add to list
     patterns.add(entry);
     patternList->updateContent();
+    
+    packUserPatternsIfNeeded();
 }
 
 void PatternBrowserComponent::savePatternToFile(const Pattern& pattern, const juce::String& name)
@@ -238,7 +334,7 @@ void PatternBrowserComponent::savePatternToFile(const Pattern& pattern, const ju
         return;
     }
 
-    auto file = patternsDirectory.getChildFile(name + kPatternFileExtension);
+    auto file = patternsDirectory.getChildFile(name + PatternFormat::kFileExtension);
     
     try {
         PatternEntry entry;
@@ -254,7 +350,9 @@ void PatternBrowserComponent::savePatternToFile(const Pattern& pattern, const ju
         }
 
         // Write to file
-        if (!file.replaceWithText(juce::JSON::toString(entry.toVar()))) {
+        juce::MemoryOutputStream data;
+        entry.writeBinary(data);
+        if (!file.replaceWithData(data.getData(), data.getDataSize())) {
             juce::Logger::writeToLog("Failed to write pattern file: " + file.getFullPathName());
         }
     }
@@ -263,13 +361,232 @@ void PatternBrowserComponent::savePatternToFile(const Pattern& pattern, const ju
     }
 }
 
+juce::File PatternBrowserComponent::getLibraryPackFile() const
+{
+    return patternsDirectory.getChildFile(juce::String(kLibraryPackName) + PatternPack::kFileExtension);
+}
+
+juce::Array<juce::File> PatternBrowserComponent::getUserPatternFiles(const juce::String& name) const
+{
+    // The binary file and any JSON it was imported from
+    juce::Array<juce::File> files;
+    for (auto* extension : { PatternFormat::kFileExtension, kPatternFileExtension }) {
+        auto file = patternsDirectory.getChildFile(name + extension);
+        if (file.existsAsFile())
+            files.add(file);
+    }
+    return files;
+}
+
+void PatternBrowserComponent::openLibraryPack()
+{
+    libraryPack.reset();
+    
+    auto file = getLibraryPackFile();
+    if (!file.existsAsFile())
+        return;
+    
+    ValidationReport report;
+    libraryPack = PatternPack::tryOpen(file, report);
+    if (libraryPack == nullptr) {
+        juce::Logger::writeToLog("Invalid pattern pack: " + file.getFullPathName() + " - " + report.describe());
+    }
+}
+
+void PatternBrowserComponent::replaceLibraryPack(PatternPack::Builder builder, std::function<void(bool)> onReplaced)
+{
+    auto packFile = getLibraryPackFile();
+    
+    if (builder.size() == 0) {
+        libraryPack.reset();
+        const bool deleted = !packFile.existsAsFile() || packFile.deleteFile();
+        if (!deleted) {
+            juce::Logger::writeToLog("Failed to delete pattern pack: " + packFile.getFullPathName());
+            openLibraryPack();
+        }
+        onReplaced(deleted);
+        return;
+    }
+    
+    // The builder may point into the current pack, so the pack stays open while
+    // the worker writes and is only swapped on the message thread
+    packWriteInProgress = true;
+    auto temp = std::make_shared<juce::TemporaryFile>(packFile);
+    auto pending = std::make_shared<PatternPack::Builder>(std::move(builder));
+    juce::Component::SafePointer<PatternBrowserComponent> safeThis(this);
+    
+    packWriteThread->addJob([safeThis, temp, pending, onReplaced = std::move(onReplaced)]() mutable {
+        const bool written = writePackFile(*pending, temp->getFile());
+        pending.reset();
+        
+        juce::MessageManager::callAsync([safeThis, temp, written, onReplaced = std::move(onReplaced)] {
+            if (safeThis == nullptr)
+                return;   // The temporary file is deleted with the last reference to it
+            
+            auto& browser = *safeThis;
+            browser.packWriteInProgress = false;
+            
+            const auto target = browser.getLibraryPackFile();
+            if (!written) {
+                juce::Logger::writeToLog("Failed to write pattern pack: " + target.getFullPathName());
+                onReplaced(false);
+                return;
+            }
+            
+            browser.libraryPack.reset();
+            const bool replaced = temp->overwriteTargetFileWithTemporary();
+            if (!replaced) {
+                juce::Logger::writeToLog("Failed to replace pattern pack: " + target.getFullPathName());
+            }
+            
+            browser.openLibraryPack();
+            onReplaced(replaced);
+        });
+    });
+}
+
+void PatternBrowserComponent::packUserPatterns()
+{
+    if (packWriteInProgress)
+        return;   // Packed after a later save
+    
+    juce::StringArray looseNames;
+    juce::Array<juce::File> looseFiles;
+    juce::Array<juce::Time> looseFileTimes;
+    juce::Array<PatternEntry*> looseEntries;
+    for (auto* entry : patterns) {
+        if (!entry->isUser())
+            continue;
+        
+        auto files = getUserPatternFiles(entry->name);
+        if (files.isEmpty())
+            continue;   // Never saved
+        
+        looseNames.add(entry->name);
+        for (const auto& file : files) {
+            looseFiles.add(file);
+            looseFileTimes.add(file.getLastModificationTime());
+        }
+        looseEntries.add(entry);
+    }
+    
+    if (looseEntries.isEmpty())
+        return;
+    
+    // Pack entries are copied without being decoded
+    PatternPack::Builder builder;
+    if (libraryPack != nullptr) {
+        for (int i = 0; i < libraryPack->size(); ++i) {
+            if (!looseNames.contains(libraryPack->getName(i)))
+                builder.add(*libraryPack, i);
+        }
+    }
+    for (auto* entry : looseEntries)
+        builder.add(*entry);
+    
+    replaceLibraryPack(std::move(builder), [this, looseFiles, looseFileTimes, looseEntries](bool replaced) {
+        if (!replaced) {
+            juce::Logger::writeToLog("Failed to pack user patterns into " + getLibraryPackFile().getFullPathName());
+            updateFilteredList();
+            return;
+        }
+        
+        // A file saved again while the pack was written is newer than its
+        // entry in the pack, so it is kept to be packed next time
+        for (int i = 0; i < looseFiles.size(); ++i) {
+            const auto& file = looseFiles.getReference(i);
+            if (file.getLastModificationTime() != looseFileTimes[i])
+                continue;
+            if (!file.deleteFile())
+                juce::Logger::writeToLog("Failed to delete packed pattern file: " + file.getFullPathName());
+        }
+        for (auto* entry : looseEntries)
+            patterns.removeObject(entry);
+        
+        updateFilteredList();
+    });
+}
+
+void PatternBrowserComponent::packUserPatternsIfNeeded()
+{
+    int numUserEntries = 0;
+    for (const auto* entry : patterns) {
+        if (entry->isUser())
+            ++numUserEntries;
+    }
+    
+    if (numUserEntries >= kLooseFilesBeforePacking)
+        packUserPatterns();
+}
+
+int PatternBrowserComponent::getNumPackEntries() const noexcept
+{
+    return libraryPack != nullptr ? libraryPack->size() : 0;
+}
+
+int PatternBrowserComponent::getNumEntries() const noexcept
+{
+    return getNumPackEntries() + patterns.size();
+}
+
+juce::String PatternBrowserComponent::getEntryText(int index, int columnId) const
+{
+    const auto numPackEntries = getNumPackEntries();
+    if (index < numPackEntries) {
+        switch (static_cast<TableColumns>(columnId))
+        {
+            case TableColumns::Name:     return libraryPack->getName(index);
+            case TableColumns::Type:     return libraryPack->getType(index);
+            case TableColumns::Style:    return libraryPack->getStyle(index);
+            case TableColumns::Modified: return libraryPack->getModified(index).toString(true, true, true, true);
+        }
+        return {};
+    }
+    
+    const auto* entry = patterns[index - numPackEntries];
+    if (entry == nullptr)
+        return {};
+    
+    switch (static_cast<TableColumns>(columnId))
+    {
+        case TableColumns::Name:     return entry->name;
+        case TableColumns::Type:     return entry->type;
+        case TableColumns::Style:    return entry->style;
+        case TableColumns::Modified: return entry->modified.toString(true, true, true, true);
+    }
+    return {};
+}
+
+bool PatternBrowserComponent::readEntry(int index, PatternEntry& result) const
+{
+    const auto numPackEntries = getNumPackEntries();
+    if (index < 0 || index >= getNumEntries())
+        return false;
+    
+    if (index >= numPackEntries) {
+        result = *patterns[index - numPackEntries];
+        return true;
+    }
+    
+    // Pack entries are decoded only here, when a pattern is actually used
+    ValidationReport report;
+    if (!libraryPack->readEntry(index, result, report)) {
+        juce::Logger::writeToLog("Invalid pattern in pack: " + libraryPack->getName(index)
+                                 + (report.isValid() ? juce::String() : " - " + report.describe()));
+        return false;
+    }
+    return true;
+}
+
 void PatternBrowserComponent::updateFilteredList()
 {
     filteredIndices.clearQuick();
     
-    for (int i = 0; i < patterns.size(); ++i)
+    const auto numEntries = getNumEntries();
+    filteredIndices.ensureStorageAllocated(numEntries);
+    for (int i = 0; i < numEntries; ++i)
     {
-        if (patternMatchesFilter(patterns[i]))
+        if (patternMatchesFilter(i))
         {
             filteredIndices.add(i);
         }
@@ -278,13 +595,13 @@ void PatternBrowserComponent::updateFilteredList()
     patternList->updateContent();
 }
 
-bool PatternBrowserComponent::patternMatchesFilter(const PatternEntry* entry) const
+bool PatternBrowserComponent::patternMatchesFilter(int index) const
 {
     if (!currentSearchText.isEmpty())
     {
-        if (!entry->name.containsIgnoreCase(currentSearchText) &&
-            !entry->style.containsIgnoreCase(currentSearchText) &&
-            !entry->type.containsIgnoreCase(currentSearchText))
+        if (!getEntryText(index, static_cast<int>(TableColumns::Name)).containsIgnoreCase(currentSearchText) &&
+            !getEntryText(index, static_cast<int>(TableColumns::Style)).containsIgnoreCase(currentSearchText) &&
+            !getEntryText(index, static_cast<int>(TableColumns::Type)).containsIgnoreCase(currentSearchText))
         {
             return false;
         }
@@ -292,7 +609,7 @@ bool PatternBrowserComponent::patternMatchesFilter(const PatternEntry* entry) co
     
     if (!currentStyleFilter.isEmpty() && currentStyleFilter != "All Styles")
     {
-        if (entry->style != currentStyleFilter)
+        if (getEntryText(index, static_cast<int>(TableColumns::Style)) != currentStyleFilter)
         {
             return false;
         }
@@ -341,30 +658,14 @@ void PatternBrowserComponent::paintCell(juce::Graphics& g, int rowNumber, int co
         return;
         
     int actualIndex = filteredIndices[rowNumber];
-    if (actualIndex >= patterns.size())
+    if (actualIndex >= getNumEntries())
         return;
         
     g.setColour(rowIsSelected ? juce::Colours::white : juce::Colours::lightgrey);
     g.setFont(14.0f);
     
-    auto entry = patterns[actualIndex];
-    juce::String text;
-    
-    switch (static_cast<TableColumns>(columnId))
-    {
-        case TableColumns::Name:
-            text = entry->name;
-            break;
-        case TableColumns::Type:
-            text = entry->type;
-            break;
-        case TableColumns::Style:
-            text = entry->style;
-            break;
-        case TableColumns::Modified:
-            text = entry->modified.toString(true, true, true, true);
-            break;
-    }
+    // Only visible rows are painted, so a pack's text is read from its index on demand
+    auto text = getEntryText(actualIndex, columnId);
     
     g.drawText(text, 2, 0, width - 4, height, juce::Justification::centredLeft);
 }
@@ -402,11 +703,31 @@ void PatternBrowserComponent::deleteSelectedPattern()
 {
     auto selectedRow = patternList->getSelectedRow();
     if (selectedRow >= 0 && selectedRow < filteredIndices.size()) {
+        // Entries are numbered against the pack being replaced, and a deleted
+        // loose file could be in the pack being written
+        if (packWriteInProgress)
+            return;
+        
         int actualIndex = filteredIndices[selectedRow];
-        if (patterns[actualIndex]->type == "User") {
-            // Delete file if it exists
-            auto file = patternsDirectory.getChildFile(patterns[actualIndex]->name + kPatternFileExtension);
-            if (file.existsAsFile()) {
+        const auto numPackEntries = getNumPackEntries();
+        if (actualIndex < numPackEntries) {
+            if (libraryPack->getType(actualIndex) != "User")
+                return;
+            
+            // The pack is rewritten without the entry, copying the others as they are
+            PatternPack::Builder builder;
+            for (int i = 0; i < numPackEntries; ++i) {
+                if (i != actualIndex)
+                    builder.add(*libraryPack, i);
+            }
+            
+            replaceLibraryPack(std::move(builder), [this](bool) { updateFilteredList(); });
+            return;
+        }
+        
+        auto* entry = patterns[actualIndex - numPackEntries];
+        if (entry->type == "User") {
+            for (const auto& file : getUserPatternFiles(entry->name)) {
                 juce::Result result = file.deleteFile() ? juce::Result::ok() : juce::Result::fail("Failed to delete file");
                 if (result.failed()) {
                     juce::Logger::writeToLog("Failed to delete pattern file: " + result.getErrorMessage());
@@ -414,7 +735,7 @@ void PatternBrowserComponent::deleteSelectedPattern()
                 }
             }
             
-            patterns.remove(actualIndex);
+            patterns.removeObject(entry);
             updateFilteredList();
         }
     }
@@ -424,40 +745,41 @@ void PatternBrowserComponent::deleteSelectedPattern()
 void PatternBrowserComponent::mouseDoubleClick(const juce::MouseEvent& event)
 {
     int row = patternList->getRowContainingPosition(event.x, event.y);
-    if (row >= 0 && row < patterns.size())
+    PatternEntry entry;
+    if (row >= 0 && row < filteredIndices.size() && readEntry(filteredIndices[row], entry))
     {
         if (onPatternDoubleClicked)
-            onPatternDoubleClicked(patterns[row]->pattern);
+            onPatternDoubleClicked(entry.pattern);
     }
 }
 
 void PatternBrowserComponent::loadPattern(const juce::String& name)
 {
-    auto file = patternsDirectory.getChildFile(name + kPatternFileExtension);
-    if (file.existsAsFile())
-    {
-        try {
-            auto jsonText = file.loadFileAsString();
-            auto jsonVar = juce::JSON::fromString(jsonText);
-            
-            if (!jsonVar.isObject()) {
-                juce::Logger::writeToLog("Invalid JSON in pattern file: " + file.getFullPathName());
-                return;
-            }
-            
-            PatternEntry entry = PatternEntry::fromVar(jsonVar);
-            if (!entry.validate()) {
-                juce::Logger::writeToLog("Invalid pattern entry");
-                return;
-            }
-            
-            patterns.add(new PatternEntry(std::move(entry)));
-            updateList();
-        }
-        catch (const std::exception& e) {
-            juce::Logger::writeToLog("Exception while loading pattern: " + juce::String(e.what()));
+    auto file = patternsDirectory.getChildFile(name + PatternFormat::kFileExtension);
+    if (!file.existsAsFile())
+        file = patternsDirectory.getChildFile(name + kPatternFileExtension);
+    
+    loadPatternFromFile(file);
+}
+
+void PatternBrowserComponent::exportSelectedPattern(const juce::File& destination)
+{
+    auto selectedRow = patternList->getSelectedRow();
+    if (selectedRow < 0 || selectedRow >= filteredIndices.size())
+        return;
+    
+    try {
+        PatternEntry entry;
+        if (!readEntry(filteredIndices[selectedRow], entry))
+            return;
+        
+        if (!destination.replaceWithText(juce::JSON::toString(entry.toVar()))) {
+            juce::Logger::writeToLog("Failed to export pattern file: " + destination.getFullPathName());
         }
     }
+    catch (const std::exception& e) {
+        juce::Logger::writeToLog("Exception while exporting pattern: " + juce::String(e.what()));
+    }
 }
 
 void PatternBrowserComponent::updateList()
@@ -3,6 +3,7 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_data_structures/juce_data_structures.h>
 #include "../Models/PatternEntry.h"
+#include "../PatternPack.h"
 
 /**
  * @brief A component that displays and manages a list of patterns
@@ -38,10 +39,24 @@ public:
     void addPattern(const Pattern& pattern, const juce::String& name);
     
     /**
-     * @brief Loads preset patterns into the browser
+     * @brief Loads preset patterns, the library pack and any loose pattern files
+     *
+     * The pack is only mapped and its header checked; rows read their text
+     * from its index and a pattern is decoded when it is loaded.
      */
     void loadPresetPatterns();
     
+    /**
+     * @brief Moves every saved user pattern file into the library pack
+     *
+     * Runs by itself once enough loose files pile up, at startup or after a
+     * save. A file replaces a pack entry with the same name. The pack is
+     * written on a worker thread and the files are deleted once it is in
+     * place; they are kept if it could not be written. Does nothing while
+     * another pack write is in progress.
+     */
+    void packUserPatterns();
+    
     /**
      * @brief Saves the current pattern with the given name
      * @param pattern The pattern to save
@@ -51,6 +66,10 @@ public:
     
     /**
      * @brief Deletes the currently selected pattern
+     *
+     * A pack entry is removed by rewriting the pack on a worker thread; the
+     * list updates once the new pack is in place. Nothing is deleted while a
+     * pack write is in progress.
      */
     void deleteSelectedPattern();
     
@@ -63,8 +82,14 @@ public:
     std::function<void(const Pattern&)> onPatternDoubleClicked;
 
     //==============================================================================
-    // Pattern loading and management
+    // Pattern loading and management; patterns are stored in the binary
+    // format, and JSON ".pattern" files are read as imports
     void loadPattern(const juce::String& name);
+    
+    /**
+     * @brief Writes the selected pattern to a JSON file for sharing; the Export button's action
+     */
+    void exportSelectedPattern(const juce::File& destination);
     void updateList();
 
 private:
@@ -74,17 +99,23 @@ private:
     std::unique_ptr<juce::TextButton> loadButton;
     std::unique_ptr<juce::TextButton> saveButton;
     std::unique_ptr<juce::TextButton> deleteButton;
+    std::unique_ptr<juce::TextButton> exportButton;
+    std::unique_ptr<juce::FileChooser> fileChooser;
     std::unique_ptr<juce::TextEditor> searchBox;
     std::unique_ptr<juce::ComboBox> styleFilter;
     
     //==============================================================================
     // Data
-    juce::OwnedArray<PatternEntry> patterns;
-    juce::Array<int> filteredIndices;  // Indices of patterns that match current filter
+    std::unique_ptr<PatternPack> libraryPack;
+    juce::OwnedArray<PatternEntry> patterns;  // Loose files and unsaved entries, numbered after the pack's
+    juce::Array<int> filteredIndices;  // Indices of entries that match current filter
     juce::File patternsDirectory;
     juce::String currentSearchText;
     juce::String currentStyleFilter;
     
+    std::unique_ptr<juce::ThreadPool> packWriteThread;
+    bool packWriteInProgress = false;   // Message thread only
+    
     //==============================================================================
     // Helper methods
     void initializeTable();
@@ -99,9 +130,25 @@ private:
     void loadPatternFromFile(const juce::File& file);
     void savePatternToFile(const Pattern& pattern, const juce::String& name);
     
+    // Library pack
+    [[nodiscard]] juce::File getLibraryPackFile() const;
+    [[nodiscard]] juce::Array<juce::File> getUserPatternFiles(const juce::String& name) const;
+    void openLibraryPack();
+    // Writes the builder to a temporary file on packWriteThread, then swaps it in
+    // on the message thread; onReplaced is called there, with false if the old
+    // pack is still in place. An empty builder deletes the pack straight away
+    void replaceLibraryPack(PatternPack::Builder builder, std::function<void(bool)> onReplaced);
+    void packUserPatternsIfNeeded();
+    
+    // Entries are numbered across the pack and then the loose patterns
+    [[nodiscard]] int getNumPackEntries() const noexcept;
+    [[nodiscard]] int getNumEntries() const noexcept;
+    [[nodiscard]] juce::String getEntryText(int index, int columnId) const;
+    bool readEntry(int index, PatternEntry& result) const;
+    
     // Filtering methods
     void updateFilteredList();
-    [[nodiscard]] bool patternMatchesFilter(const PatternEntry* entry) const;
+    [[nodiscard]] bool patternMatchesFilter(int index) const;
     
     // Preset patterns
     void createBasicPatterns();
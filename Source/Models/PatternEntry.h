@@ -5,6 +5,9 @@
 
 /**
  * @brief Represents a pattern entry in the browser with metadata
+ *
+ * Copying an entry shares its pattern's note storage, so the compiler-generated
+ * copy and move operations are cheap.
  */
 struct PatternEntry {
     Pattern pattern;
@@ -23,36 +26,6 @@ struct PatternEntry {
         , modified(juce::Time::getCurrentTime())
     {}
     
-    PatternEntry(const PatternEntry& other)
-        : pattern(other.pattern)
-        , name(other.name)
-        , type(other.type)
-        , style(other.style)
-        , modified(other.modified)
-    {}
-    
-    PatternEntry(PatternEntry&& other) noexcept
-        : pattern(std::move(other.pattern))
-        , name(std::move(other.name))
-        , type(std::move(other.type))
-        , style(std::move(other.style))
-        , modified(other.modified)
-    {}
-    
-    PatternEntry& operator=(PatternEntry other) noexcept {
-        swap(*this, other);
-        return *this;
-    }
-    
-    friend void swap(PatternEntry& first, PatternEntry& second) noexcept {
-        using std::swap;
-        swap(first.pattern, second.pattern);
-        swap(first.name, second.name);
-        swap(first.type, second.type);
-        swap(first.style, second.style);
-        swap(first.modified, second.modified);
-    }
-
     /**
      * @brief Validates the entry's data
      */
@@ -65,7 +38,7 @@ struct PatternEntry {
     }
 
     /**
-     * @brief Converts the entry to a var for serialization
+     * @brief Converts the entry to a var, for JSON import and export
      */
     [[nodiscard]] juce::var toVar() const {
         auto obj = std::make_unique<juce::DynamicObject>();
@@ -79,23 +52,13 @@ struct PatternEntry {
 
     /**
      * @brief Creates a PatternEntry from a var
-     * @return A pair containing the entry and a boolean indicating success
+     * @throws InvalidNoteException or std::invalid_argument if the pattern is invalid
      */
     static PatternEntry fromVar(const juce::var& v) {
         PatternEntry entry;
         
         if (auto* obj = v.getDynamicObject()) {
-            entry.name = obj->getProperty(juce::Identifier("name")).toString();
-            entry.type = obj->getProperty(juce::Identifier("type")).toString();
-            entry.style = obj->getProperty(juce::Identifier("style")).toString();
-            
-            auto modifiedVar = obj->getProperty(juce::Identifier("modified"));
-            if (!modifiedVar.isVoid()) {
-                double milliseconds = modifiedVar.toString().getDoubleValue();
-                entry.modified = juce::Time(static_cast<int64_t>(milliseconds));
-            } else {
-                entry.modified = juce::Time::getCurrentTime();
-            }
+            entry.readMetadata(*obj);
             
             if (auto patternVar = obj->getProperty(juce::Identifier("pattern"))) {
                 entry.pattern = Pattern::fromVar(patternVar);
@@ -104,8 +67,99 @@ struct PatternEntry {
         
         return entry;
     }
+
+    /**
+     * @brief Creates a PatternEntry from a var without throwing, for bulk loading
+     * @param report Receives the pattern's problems, including every offending note index,
+     *               or InvalidMetadata if the name, type or style is unusable
+     * @return False if the pattern could not be read or the entry fails validate()
+     */
+    static bool tryFromVar(const juce::var& v, PatternEntry& result, ValidationReport& report) {
+        report = {};
+        auto* obj = v.getDynamicObject();
+        if (obj == nullptr) {
+            report.error = ValidationError::NotAnObject;
+            return false;
+        }
+        
+        PatternEntry entry;
+        entry.readMetadata(*obj);
+        
+        if (auto patternVar = obj->getProperty(juce::Identifier("pattern"))) {
+            if (!Pattern::tryFromVar(patternVar, entry.pattern, report)) {
+                return false;
+            }
+        }
+        
+        if (!entry.validate()) {
+            report.error = ValidationError::InvalidMetadata;
+            return false;
+        }
+        
+        result = std::move(entry);
+        return true;
+    }
+    
+    /**
+     * @brief Writes the entry as a binary pattern with a metadata trailer
+     *
+     * The trailer follows the note records: the modification time as int64
+     * milliseconds, then name, type and style as length-prefixed UTF-8.
+     */
+    void writeBinary(juce::OutputStream& out) const {
+        pattern.writeBinary(out);
+        out.writeInt64(modified.toMilliseconds());
+        PatternFormat::writeString(out, name);
+        PatternFormat::writeString(out, type);
+        PatternFormat::writeString(out, style);
+    }
+
+    /**
+     * @brief Reads an entry written by writeBinary without throwing
+     * @param data May point into a memory-mapped file; nothing is kept after returning
+     * @return False if the data is not a complete entry or the entry fails validate()
+     */
+    static bool tryFromBinary(const void* data, size_t size, PatternEntry& result, ValidationReport& report) {
+        PatternEntry entry;
+        size_t patternSize = 0;
+        if (!Pattern::tryFromBinary(data, size, entry.pattern, report, &patternSize)) {
+            return false;
+        }
+        
+        PatternFormat::ByteReader reader(data, size);
+        juce::int64 milliseconds = 0;
+        if (!reader.skip(patternSize) || !reader.readInt64(milliseconds)
+            || !reader.readString(entry.name) || !reader.readString(entry.type) || !reader.readString(entry.style)) {
+            report.error = ValidationError::Truncated;
+            return false;
+        }
+        entry.modified = juce::Time(milliseconds);
+        
+        if (!entry.validate()) {
+            report.error = ValidationError::InvalidMetadata;
+            return false;
+        }
+        
+        result = std::move(entry);
+        return true;
+    }
     
     [[nodiscard]] bool isPreset() const { return type == "Preset"; }
     [[nodiscard]] bool isUser() const { return type == "User"; }
     [[nodiscard]] juce::String getDisplayName() const { return name + " (" + style + ")"; }
+
+private:
+    void readMetadata(const juce::DynamicObject& obj) {
+        name = obj.getProperty(juce::Identifier("name")).toString();
+        type = obj.getProperty(juce::Identifier("type")).toString();
+        style = obj.getProperty(juce::Identifier("style")).toString();
+        
+        auto modifiedVar = obj.getProperty(juce::Identifier("modified"));
+        if (!modifiedVar.isVoid()) {
+            double milliseconds = modifiedVar.toString().getDoubleValue();
+            modified = juce::Time(static_cast<int64_t>(milliseconds));
+        } else {
+            modified = juce::Time::getCurrentTime();
+        }
+    }
 }; 
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * @brief Fixed-capacity queue of pending note-offs, keyed by absolute sample time
+ *
+ * A binary min-heap ordered by due time, so gates can outlive the block (and
+ * the step) that started them. Notes are keyed by MIDI channel and note
+ * number. Retriggering or cancelling a note bumps its generation instead of
+ * searching the heap; stale entries are discarded as they surface. Nothing
+ * allocates after construction.
+ *
+ * Not thread-safe: use from the audio thread only.
+ */
+class NoteOffScheduler {
+public:
+    static constexpr int kCapacity = 256;
+    static constexpr int kNumMidiNotes = 128;
+    static constexpr int kNumChannels = 16;
+    static constexpr int kNumKeys = kNumMidiNotes * kNumChannels;
+
+    NoteOffScheduler() { clear(); }
+
+    void clear() noexcept {
+        size = 0;
+        held.fill(false);
+    }
+
+    [[nodiscard]] bool isEmpty() const noexcept { return size == 0; }
+    [[nodiscard]] bool isFull() const noexcept { return size == kCapacity; }
+
+    // True while a scheduled note-off for this note is still outstanding
+    [[nodiscard]] bool isHeld(int channel, int note) const noexcept {
+        const int key = getKey(channel, note);
+        return key >= 0 && held[static_cast<size_t>(key)];
+    }
+
+    // Due time of the earliest entry; only meaningful when not empty
+    [[nodiscard]] juce::int64 getNextTime() const noexcept { return heap[0].time; }
+
+    /**
+     * @brief Schedules a note-off, replacing any outstanding one for the same note
+     * @return False if the queue is full; the caller should pop an entry and retry
+     */
+    bool schedule(juce::int64 time, int channel, int note) noexcept {
+        const int key = getKey(channel, note);
+        if (key < 0 || isFull())
+            return false;
+
+        const auto k = static_cast<size_t>(key);
+        held[k] = true;
+        heap[static_cast<size_t>(size)] = { time, key, ++generations[k] };
+        siftUp(size++);
+        return true;
+    }
+
+    // Drops the outstanding note-off for a note without reporting it
+    void cancel(int channel, int note) noexcept {
+        if (!isHeld(channel, note))
+            return;
+
+        const auto k = static_cast<size_t>(getKey(channel, note));
+        held[k] = false;
+        ++generations[k];
+    }
+
+    /**
+     * @brief Reports every note-off due before endTime, earliest first
+     * @param onNoteOff Called with the channel and note number of each live entry
+     */
+    template <typename Callback>
+    void popDue(juce::int64 endTime, Callback&& onNoteOff) noexcept {
+        while (size > 0 && heap[0].time < endTime)
+            popNext(onNoteOff);
+    }
+
+    // Removes the earliest entry, reporting it if it is still live
+    template <typename Callback>
+    void popNext(Callback&& onNoteOff) noexcept {
+        if (size == 0)
+            return;
+
+        const auto entry = heap[0];
+        heap[0] = heap[static_cast<size_t>(--size)];
+        siftDown(0);
+
+        const auto k = static_cast<size_t>(entry.key);
+        if (entry.generation == generations[k] && held[k]) {
+            held[k] = false;
+            onNoteOff(entry.key / kNumMidiNotes + 1, entry.key % kNumMidiNotes);
+        }
+    }
+
+    // Reports every outstanding note-off immediately and empties the queue
+    template <typename Callback>
+    void flush(Callback&& onNoteOff) noexcept {
+        if (size > 0)
+            for (int key = 0; key < kNumKeys; ++key)
+                if (held[static_cast<size_t>(key)])
+                    onNoteOff(key / kNumMidiNotes + 1, key % kNumMidiNotes);
+
+        clear();
+    }
+
+private:
+    struct Entry {
+        juce::int64 time{0};
+        int key{0};
+        juce::uint32 generation{0};
+    };
+
+    static int getKey(int channel, int note) noexcept {
+        if (channel < 1 || channel > kNumChannels || note < 0 || note >= kNumMidiNotes)
+            return -1;
+        return (channel - 1) * kNumMidiNotes + note;
+    }
+
+    void siftUp(int index) noexcept {
+        const auto entry = heap[static_cast<size_t>(index)];
+        while (index > 0) {
+            const int parent = (index - 1) / 2;
+            if (heap[static_cast<size_t>(parent)].time <= entry.time)
+                break;
+            heap[static_cast<size_t>(index)] = heap[static_cast<size_t>(parent)];
+            index = parent;
+        }
+        heap[static_cast<size_t>(index)] = entry;
+    }
+
+    void siftDown(int index) noexcept {
+        if (size == 0)
+            return;
+
+        const auto entry = heap[static_cast<size_t>(index)];
+        for (;;) {
+            int child = index * 2 + 1;
+            if (child >= size)
+                break;
+            if (child + 1 < size && heap[static_cast<size_t>(child + 1)].time < heap[static_cast<size_t>(child)].time)
+                ++child;
+            if (entry.time <= heap[static_cast<size_t>(child)].time)
+                break;
+            heap[static_cast<size_t>(index)] = heap[static_cast<size_t>(child)];
+            index = child;
+        }
+        heap[static_cast<size_t>(index)] = entry;
+    }
+
+    std::array<Entry, kCapacity> heap{};
+    std::array<juce::uint32, kNumKeys> generations{};
+    std::array<bool, kNumKeys> held{};
+    int size{0};
+
+    JUCE_DECLARE_NON_COPYABLE(NoteOffScheduler)
+};
@@ -2,7 +2,10 @@
 #define GROOVE_SEQUENCER_PATTERN_H
 
 #include <JuceHeader.h>
+#include "PatternFormat.h"
+#include <cmath>
 #include <vector>
+#include <memory>
 #include <stdexcept>
 
 // Constants for validation
@@ -17,6 +20,7 @@ namespace PatternConstants {
     constexpr int MAX_ACCENT = 2;
     constexpr int MIN_LENGTH = 1;
     constexpr int MAX_LENGTH = 128;
+    constexpr int MAX_NOTES = 128;           // A 64-step generated pattern, mirrored
     constexpr double MIN_TEMPO = 20.0;
     constexpr double MAX_TEMPO = 300.0;
     constexpr double MIN_GRID_SIZE = 0.0625; // 1/64 note
@@ -29,6 +33,86 @@ public:
         : std::runtime_error(message) {}
 };
 
+// Why a note or pattern failed validation, for the non-throwing paths
+enum class ValidationError {
+    None,
+    InvalidPitch,
+    InvalidVelocity,
+    InvalidStartTime,
+    InvalidDuration,
+    InvalidAccent,
+    InvalidLength,
+    InvalidTempo,
+    InvalidGridSize,
+    NoteOutsidePattern,
+    NotAnObject,
+    MalformedJson,
+    NotBinaryPattern,
+    UnsupportedVersion,
+    CorruptHeader,
+    Truncated,
+    NotPatternPack,
+    ChecksumMismatch,
+    InvalidMetadata,
+    TooManyNotes
+};
+
+inline const char* getValidationErrorName(ValidationError error) noexcept {
+    switch (error) {
+        case ValidationError::None: return "None";
+        case ValidationError::InvalidPitch: return "Invalid MIDI note number";
+        case ValidationError::InvalidVelocity: return "Invalid velocity";
+        case ValidationError::InvalidStartTime: return "Invalid start time";
+        case ValidationError::InvalidDuration: return "Invalid duration";
+        case ValidationError::InvalidAccent: return "Invalid accent";
+        case ValidationError::InvalidLength: return "Invalid pattern length";
+        case ValidationError::InvalidTempo: return "Invalid tempo";
+        case ValidationError::InvalidGridSize: return "Invalid grid size";
+        case ValidationError::NoteOutsidePattern: return "Note outside pattern";
+        case ValidationError::NotAnObject: return "Not an object";
+        case ValidationError::MalformedJson: return "Malformed JSON";
+        case ValidationError::NotBinaryPattern: return "Not a binary pattern";
+        case ValidationError::UnsupportedVersion: return "Unsupported format version";
+        case ValidationError::CorruptHeader: return "Corrupt header";
+        case ValidationError::Truncated: return "Truncated data";
+        case ValidationError::NotPatternPack: return "Not a pattern pack";
+        case ValidationError::ChecksumMismatch: return "Checksum mismatch";
+        case ValidationError::InvalidMetadata: return "Invalid name, type or style";
+        case ValidationError::TooManyNotes: return "Too many notes";
+        default: return "Unknown";
+    }
+}
+
+/**
+ * @brief Outcome of a non-throwing pattern check
+ *
+ * Holds the first problem found and the index of every offending note, so a
+ * bulk loader can report and skip bad data without unwinding.
+ */
+struct ValidationReport {
+    ValidationError error{ValidationError::None};
+    std::vector<int> invalidNotes;
+
+    [[nodiscard]] bool isValid() const noexcept { return error == ValidationError::None; }
+
+    [[nodiscard]] juce::String describe() const {
+        juce::String text(getValidationErrorName(error));
+        if (!invalidNotes.empty()) {
+            juce::StringArray indices;
+            for (const auto index : invalidNotes)
+                indices.add(juce::String(index));
+            text << " (notes " << indices.joinIntoString(", ") << ")";
+        }
+        return text;
+    }
+};
+
+// How much of a pattern a check covers
+enum class PatternCheck {
+    Full,        // Fields, notes, and every note inside the pattern's length
+    Structural   // Fields and notes only; for restoring what was saved as it was
+};
+
 struct Note {
     int pitch{60};            // MIDI note number (0-127)
     float velocity{100.0f};   // Note velocity (0-127)
@@ -67,33 +151,38 @@ struct Note {
         return !(*this == other);
     }
     
-    void validate() const {
+    // First problem with this note, without throwing
+    [[nodiscard]] ValidationError check() const noexcept {
         using namespace PatternConstants;
         
-        if (pitch < MIN_MIDI_NOTE || pitch > MAX_MIDI_NOTE) {
-            throw InvalidNoteException("Invalid MIDI note number: " + std::to_string(pitch));
-        }
-        if (velocity < MIN_VELOCITY || velocity > MAX_VELOCITY) {
-            throw InvalidNoteException("Invalid velocity: " + std::to_string(velocity));
-        }
-        if (startTime < MIN_TIME) {
-            throw InvalidNoteException("Invalid start time: " + std::to_string(startTime));
-        }
-        if (duration < MIN_DURATION) {
-            throw InvalidNoteException("Invalid duration: " + std::to_string(duration));
-        }
-        if (accent < MIN_ACCENT || accent > MAX_ACCENT) {
-            throw InvalidNoteException("Invalid accent: " + std::to_string(accent));
+        if (pitch < MIN_MIDI_NOTE || pitch > MAX_MIDI_NOTE) return ValidationError::InvalidPitch;
+        // Written so that NaN fails every range
+        if (!(velocity >= MIN_VELOCITY && velocity <= MAX_VELOCITY)) return ValidationError::InvalidVelocity;
+        if (!(startTime >= MIN_TIME) || !std::isfinite(startTime)) return ValidationError::InvalidStartTime;
+        if (!(duration >= MIN_DURATION) || !std::isfinite(duration)) return ValidationError::InvalidDuration;
+        if (accent < MIN_ACCENT || accent > MAX_ACCENT) return ValidationError::InvalidAccent;
+        return ValidationError::None;
+    }
+    
+    void validate() const {
+        switch (check()) {
+            case ValidationError::InvalidPitch:
+                throw InvalidNoteException("Invalid MIDI note number: " + std::to_string(pitch));
+            case ValidationError::InvalidVelocity:
+                throw InvalidNoteException("Invalid velocity: " + std::to_string(velocity));
+            case ValidationError::InvalidStartTime:
+                throw InvalidNoteException("Invalid start time: " + std::to_string(startTime));
+            case ValidationError::InvalidDuration:
+                throw InvalidNoteException("Invalid duration: " + std::to_string(duration));
+            case ValidationError::InvalidAccent:
+                throw InvalidNoteException("Invalid accent: " + std::to_string(accent));
+            default:
+                break;
         }
     }
     
     [[nodiscard]] bool isValid() const noexcept {
-        try {
-            validate();
-            return true;
-        } catch (const InvalidNoteException&) {
-            return false;
-        }
+        return check() == ValidationError::None;
     }
     
     [[nodiscard]] juce::var toVar() const {
@@ -111,6 +200,13 @@ struct Note {
     }
     
     static Note fromVar(const juce::var& v) {
+        auto note = fromVarUnchecked(v);
+        note.validate();
+        return note;
+    }
+    
+    // Reads the fields as they are; pair with check() instead of catching
+    static Note fromVarUnchecked(const juce::var& v) {
         Note note;
         if (auto* obj = v.getDynamicObject()) {
             note.pitch = static_cast<int>(obj->getProperty("pitch"));
@@ -121,12 +217,19 @@ struct Note {
             note.active = static_cast<bool>(obj->getProperty("active"));
             note.isStaccato = static_cast<bool>(obj->getProperty("isStaccato"));
             note.isRest = static_cast<bool>(obj->getProperty("isRest"));
-            note.validate();
         }
         return note;
     }
 };
 
+/**
+ * @brief A sequence of notes plus its length, tempo and grid
+ *
+ * Copies share one ref-counted note buffer, so handing a pattern around costs
+ * a pointer copy; the first mutation through a shared copy duplicates the
+ * notes (copy-on-write). A single Pattern object is not thread-safe, but
+ * copies on different threads are independent.
+ */
 class Pattern {
 public:
     Pattern(int len = 16, double tmp = 120.0, double grid = 0.25)
@@ -134,20 +237,33 @@ public:
         , tempo_(validateTempo(tmp))
         , gridSize_(validateGridSize(grid))
     {
-        notes_.reserve(static_cast<size_t>(length_));
     }
     
     // Getters
     [[nodiscard]] int getLength() const noexcept { return length_; }
     [[nodiscard]] double getTempo() const noexcept { return tempo_; }
     [[nodiscard]] double getGridSize() const noexcept { return gridSize_; }
-    [[nodiscard]] const std::vector<Note>& getNotes() const noexcept { return notes_; }
-    std::vector<Note>& getNotes() noexcept { return notes_; }  // Non-const access for modifications
+    [[nodiscard]] const std::vector<Note>& getNotes() const noexcept { return *notes_; }
+    
+    // Non-const access for modifications; unshares the notes first, so don't keep
+    // the reference across a copy of this pattern
+    std::vector<Note>& getNotes() {
+        detach();
+        return *notes_;
+    }
+    
+    void setNotes(std::vector<Note> notes) {
+        notes_ = std::make_shared<std::vector<Note>>(std::move(notes));
+    }
+    
+    // True if both patterns read the same note buffer
+    [[nodiscard]] bool sharesNotesWith(const Pattern& other) const noexcept {
+        return notes_ == other.notes_;
+    }
     
     // Setters with validation
     void setLength(int len) {
         length_ = validateLength(len);
-        notes_.reserve(static_cast<size_t>(length_));
     }
     
     void setTempo(double tmp) {
@@ -165,7 +281,7 @@ public:
         obj->setProperty("gridSize", gridSize_);
         
         juce::Array<juce::var> notesArray;
-        for (const auto& note : notes_) {
+        for (const auto& note : *notes_) {
             notesArray.add(note.toVar());
         }
         obj->setProperty("notes", notesArray);
@@ -181,86 +297,292 @@ public:
             pattern.setGridSize(static_cast<double>(obj->getProperty("gridSize")));
             
             if (auto* notesArray = obj->getProperty("notes").getArray()) {
-                pattern.notes_.reserve(static_cast<size_t>(notesArray->size()));
+                std::vector<Note> notes;
+                notes.reserve(static_cast<size_t>(notesArray->size()));
                 for (const auto& noteVar : *notesArray) {
-                    pattern.notes_.push_back(Note::fromVar(noteVar));
+                    notes.push_back(Note::fromVar(noteVar));
                 }
+                pattern.setNotes(std::move(notes));
             }
         }
         return pattern;
     }
     
+    /**
+     * @brief Reads a pattern without throwing, for bulk loading
+     * @param report Receives the first problem and every offending note index
+     * @return False, leaving result untouched, if the data is not a valid pattern
+     */
+    static bool tryFromVar(const juce::var& v, Pattern& result, ValidationReport& report) {
+        report = {};
+        auto* obj = v.getDynamicObject();
+        if (obj == nullptr) {
+            report.error = ValidationError::NotAnObject;
+            return false;
+        }
+        
+        std::vector<Note> notes;
+        if (auto* notesArray = obj->getProperty("notes").getArray()) {
+            notes.reserve(static_cast<size_t>(notesArray->size()));
+            for (const auto& noteVar : *notesArray) {
+                notes.push_back(Note::fromVarUnchecked(noteVar));
+            }
+        }
+        
+        return tryCreate(static_cast<int>(obj->getProperty("length")),
+                         static_cast<double>(obj->getProperty("tempo")),
+                         static_cast<double>(obj->getProperty("gridSize")),
+                         std::move(notes), result, report);
+    }
+    
+    /**
+     * @brief Builds a pattern from fields read by a parser, without throwing
+     * @param report Receives the first problem and every offending note index
+     * @param level Structural accepts notes past the pattern's length
+     * @return False, leaving result untouched, if the fields do not make a valid pattern
+     */
+    static bool tryCreate(int length, double tempo, double gridSize, std::vector<Note> notes,
+                          Pattern& result, ValidationReport& report, PatternCheck level = PatternCheck::Full) {
+        Pattern pattern;
+        pattern.length_ = length;
+        pattern.tempo_ = tempo;
+        pattern.gridSize_ = gridSize;
+        if (!notes.empty()) {
+            pattern.setNotes(std::move(notes));
+        }
+        
+        report = pattern.check(level);
+        if (!report.isValid()) {
+            return false;
+        }
+        
+        result = std::move(pattern);
+        return true;
+    }
+    
+    /**
+     * @brief Writes the pattern in the binary format described in PatternFormat.h
+     *
+     * Pitch and accent are stored in a byte each, so validate the pattern first.
+     */
+    void writeBinary(juce::OutputStream& out) const {
+        using namespace PatternFormat;
+        
+        out.write(kMagic, sizeof(kMagic));
+        out.writeShort(static_cast<short>(kVersion));
+        out.writeShort(static_cast<short>(kHeaderSize));
+        out.writeInt(static_cast<int>(notes_->size()));
+        out.writeInt(static_cast<int>(kNoteSize));
+        out.writeInt(length_);
+        out.writeInt(0);
+        out.writeDouble(tempo_);
+        out.writeDouble(gridSize_);
+        
+        for (const auto& note : *notes_) {
+            const auto flags = static_cast<juce::uint8>((note.active ? kActiveFlag : 0)
+                                                        | (note.isStaccato ? kStaccatoFlag : 0)
+                                                        | (note.isRest ? kRestFlag : 0));
+            out.writeFloat(note.startTime);
+            out.writeFloat(note.duration);
+            out.writeFloat(note.velocity);
+            out.writeByte(static_cast<char>(juce::jlimit(0, 255, note.pitch)));
+            out.writeByte(static_cast<char>(juce::jlimit(0, 255, note.accent)));
+            out.writeByte(static_cast<char>(flags));
+            out.writeByte(0);
+        }
+    }
+    
+    /**
+     * @brief Reads a binary pattern without throwing, checking its bounds once up front
+     * @param data May point into a memory-mapped file; nothing is kept after returning
+     * @param bytesUsed If given, receives the size of the pattern, where any trailer starts
+     * @return False, leaving result untouched, if the data is not a valid pattern
+     */
+    static bool tryFromBinary(const void* data, size_t size, Pattern& result, ValidationReport& report,
+                              size_t* bytesUsed = nullptr) {
+        using namespace PatternFormat;
+        
+        report = {};
+        const auto* bytes = static_cast<const juce::uint8*>(data);
+        if (bytes == nullptr || size < sizeof(kMagic) || std::memcmp(bytes, kMagic, sizeof(kMagic)) != 0) {
+            report.error = ValidationError::NotBinaryPattern;
+            return false;
+        }
+        if (size < kHeaderSize) {
+            report.error = ValidationError::Truncated;
+            return false;
+        }
+        
+        const auto version = juce::ByteOrder::littleEndianShort(bytes + 4);
+        if (version == 0 || version > kVersion) {
+            report.error = ValidationError::UnsupportedVersion;
+            return false;
+        }
+        
+        const size_t headerSize = juce::ByteOrder::littleEndianShort(bytes + 6);
+        const size_t noteCount = juce::ByteOrder::littleEndianInt(bytes + 8);
+        const size_t noteSize = juce::ByteOrder::littleEndianInt(bytes + 12);
+        if (headerSize < kHeaderSize || noteSize < kNoteSize) {
+            report.error = ValidationError::CorruptHeader;
+            return false;
+        }
+        
+        // The only bounds check: every record must fit in what is left after the header
+        if (headerSize > size || noteCount > (size - headerSize) / noteSize) {
+            report.error = ValidationError::Truncated;
+            return false;
+        }
+        
+        std::vector<Note> notes(noteCount);
+        const auto* record = bytes + headerSize;
+        for (auto& note : notes) {
+            note.startTime = readFloat(record);
+            note.duration = readFloat(record + 4);
+            note.velocity = readFloat(record + 8);
+            note.pitch = record[12];
+            note.accent = record[13];
+            note.active = (record[14] & kActiveFlag) != 0;
+            note.isStaccato = (record[14] & kStaccatoFlag) != 0;
+            note.isRest = (record[14] & kRestFlag) != 0;
+            record += noteSize;
+        }
+        
+        if (!tryCreate(readInt32(bytes + 16), readDouble(bytes + 24), readDouble(bytes + 32),
+                       std::move(notes), result, report)) {
+            return false;
+        }
+        
+        if (bytesUsed != nullptr) {
+            *bytesUsed = headerSize + noteCount * noteSize;
+        }
+        return true;
+    }
+    
     void removeNote(size_t index) {
-        if (index < notes_.size()) {
-            notes_.erase(notes_.begin() + static_cast<std::ptrdiff_t>(index));
+        if (index < notes_->size()) {
+            detach();
+            notes_->erase(notes_->begin() + static_cast<std::ptrdiff_t>(index));
         }
     }
     
     void addNote(const Note& note) {
         note.validate();
-        notes_.push_back(note);
+        detach();
+        notes_->push_back(note);
     }
     
     void clear() {
-        notes_.clear();
+        notes_ = getEmptyNotes();
     }
     
     [[nodiscard]] bool isEmpty() const noexcept {
-        return notes_.empty();
+        return notes_->empty();
     }
     
     [[nodiscard]] size_t size() const noexcept {
-        return notes_.size();
+        return notes_->size();
     }
 
     [[nodiscard]] size_t getNoteCount() const noexcept {
-        return notes_.size();
+        return notes_->size();
     }
 
     [[nodiscard]] bool validate() const noexcept {
-        try {
-            validateLength(length_);
-            validateTempo(tempo_);
-            validateGridSize(gridSize_);
-            
-            for (const auto& note : notes_) {
-                note.validate();
-                if (note.startTime >= static_cast<float>(length_) || 
-                    note.startTime + note.duration > static_cast<float>(length_)) {
-                    return false;
-                }
-            }
+        return checkEach([](int, ValidationError) { return false; }) == ValidationError::None;
+    }
+    
+    // Every problem with this pattern, without throwing
+    [[nodiscard]] ValidationReport check(PatternCheck level = PatternCheck::Full) const {
+        ValidationReport report;
+        report.error = checkEach([&report](int index, ValidationError) {
+            report.invalidNotes.push_back(index);
             return true;
-        } catch (...) {
-            return false;
-        }
+        }, level);
+        return report;
     }
 
 private:
-    std::vector<Note> notes_;
+    // Shared by every pattern with no notes, so default construction never allocates
+    static const std::shared_ptr<std::vector<Note>>& getEmptyNotes() {
+        static const auto empty = std::make_shared<std::vector<Note>>();
+        return empty;
+    }
+    
+    void detach() {
+        if (notes_.use_count() > 1) {
+            notes_ = std::make_shared<std::vector<Note>>(*notes_);
+        }
+    }
+    
+    std::shared_ptr<std::vector<Note>> notes_{getEmptyNotes()};
     int length_{16};           // Pattern length in beats
     double tempo_{120.0};      // Tempo in BPM
     double gridSize_{0.25};    // Grid size in beats (0.25 = 16th notes)
 
+    static bool isValidLength(int len) noexcept {
+        return len >= PatternConstants::MIN_LENGTH && len <= PatternConstants::MAX_LENGTH;
+    }
+    
+    static bool isValidTempo(double tmp) noexcept {
+        return tmp >= PatternConstants::MIN_TEMPO && tmp <= PatternConstants::MAX_TEMPO;
+    }
+    
+    static bool isValidGridSize(double grid) noexcept {
+        return grid >= PatternConstants::MIN_GRID_SIZE && grid <= PatternConstants::MAX_GRID_SIZE;
+    }
+    
+    /**
+     * @brief Walks the pattern's fields, then its notes, reporting each bad note
+     * @param onInvalidNote Called with the note index and problem; return false to stop early
+     * @param level Structural skips the NoteOutsidePattern check
+     * @return The first problem found, or None
+     */
+    template <typename Callback>
+    ValidationError checkEach(Callback&& onInvalidNote, PatternCheck level = PatternCheck::Full) const {
+        if (!isValidLength(length_)) return ValidationError::InvalidLength;
+        if (!isValidTempo(tempo_)) return ValidationError::InvalidTempo;
+        if (!isValidGridSize(gridSize_)) return ValidationError::InvalidGridSize;
+        if (notes_->size() > static_cast<size_t>(PatternConstants::MAX_NOTES)) return ValidationError::TooManyNotes;
+        
+        const auto patternEnd = static_cast<float>(length_);
+        auto firstError = ValidationError::None;
+        const auto& notes = *notes_;
+        for (size_t i = 0; i < notes.size(); ++i) {
+            const auto& note = notes[i];
+            auto error = note.check();
+            if (error == ValidationError::None && level == PatternCheck::Full &&
+                (note.startTime >= patternEnd || note.startTime + note.duration > patternEnd)) {
+                error = ValidationError::NoteOutsidePattern;
+            }
+            if (error == ValidationError::None) {
+                continue;
+            }
+            if (firstError == ValidationError::None) {
+                firstError = error;
+            }
+            if (!onInvalidNote(static_cast<int>(i), error)) {
+                break;
+            }
+        }
+        return firstError;
+    }
+    
     static int validateLength(int len) {
-        using namespace PatternConstants;
-        if (len < MIN_LENGTH || len > MAX_LENGTH) {
+        if (!isValidLength(len)) {
             throw std::invalid_argument("Invalid pattern length: " + std::to_string(len));
         }
         return len;
     }
     
     static double validateTempo(double tmp) {
-        using namespace PatternConstants;
-        if (tmp < MIN_TEMPO || tmp > MAX_TEMPO) {
+        if (!isValidTempo(tmp)) {
             throw std::invalid_argument("Invalid tempo: " + std::to_string(tmp));
         }
         return tmp;
     }
     
     static double validateGridSize(double grid) {
-        using namespace PatternConstants;
-        if (grid < MIN_GRID_SIZE || grid > MAX_GRID_SIZE) {
+        if (!isValidGridSize(grid)) {
             throw std::invalid_argument("Invalid grid size: " + std::to_string(grid));
         }
         return grid;
@@ -0,0 +1,274 @@
+#include "PatternDeltaCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    using namespace PatternFormat;
+
+    constexpr juce::uint8 kTickTimes = 0;
+    constexpr juce::uint8 kFloatBitTimes = 1;
+
+    // Fields of a record that missed the prediction; a record of zero is a run
+    constexpr juce::uint8 kStartChanged = 1 << 0;
+    constexpr juce::uint8 kDurationChanged = 1 << 1;
+    constexpr juce::uint8 kVelocityChanged = 1 << 2;
+    constexpr juce::uint8 kPitchChanged = 1 << 3;
+    constexpr juce::uint8 kAttributesChanged = 1 << 4;
+    constexpr juce::uint8 kAllChanges = 0x1f;
+
+    // Bounds what a damaged chunk can make the decoder allocate
+    constexpr juce::uint64 kMaxNotes = 1 << 20;
+
+    // Beyond this a time is stored as float bits, keeping tick arithmetic far from overflow
+    constexpr double kMaxTickTime = 1.0e9;
+
+    juce::uint32 getBits(float value) noexcept
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float fromBits(juce::uint32 bits) noexcept
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    float ticksToTime(juce::int64 ticks) noexcept
+    {
+        return static_cast<float>(static_cast<double>(ticks) / static_cast<double>(PatternDeltaCodec::kTicksPerBeat));
+    }
+
+    // True if the time survives a round trip through ticks bit for bit
+    bool isWholeTicks(float time) noexcept
+    {
+        if (!(std::abs(time) < kMaxTickTime))
+            return false;
+
+        const auto ticks = std::llround(static_cast<double>(time) * static_cast<double>(PatternDeltaCodec::kTicksPerBeat));
+        return getBits(ticksToTime(ticks)) == getBits(time);
+    }
+
+    // Deltas wrap rather than overflow, so damaged data can't cause undefined behaviour
+    juce::int64 wrapAdd(juce::int64 a, juce::int64 b) noexcept
+    {
+        return static_cast<juce::int64>(static_cast<juce::uint64>(a) + static_cast<juce::uint64>(b));
+    }
+
+    juce::int64 wrapSubtract(juce::int64 a, juce::int64 b) noexcept
+    {
+        return static_cast<juce::int64>(static_cast<juce::uint64>(a) - static_cast<juce::uint64>(b));
+    }
+
+    int toInt(juce::int64 value) noexcept
+    {
+        return static_cast<int>(juce::jlimit(static_cast<juce::int64>(std::numeric_limits<int>::min()),
+                                             static_cast<juce::int64>(std::numeric_limits<int>::max()),
+                                             value));
+    }
+
+    // A note with its times in the chunk's time units and its flags in one byte
+    struct NoteUnits {
+        juce::int64 start{0};
+        juce::int64 duration{0};
+        juce::uint32 velocity{0};
+        juce::int64 pitch{0};
+        juce::uint8 attributes{0};
+    };
+
+    NoteUnits toUnits(const Note& note, bool useTicks) noexcept
+    {
+        const auto toTimeUnits = [useTicks](float time) -> juce::int64 {
+            if (useTicks)
+                return std::llround(static_cast<double>(time) * static_cast<double>(PatternDeltaCodec::kTicksPerBeat));
+            return getBits(time);
+        };
+
+        NoteUnits units;
+        units.start = toTimeUnits(note.startTime);
+        units.duration = toTimeUnits(note.duration);
+        units.velocity = getBits(note.velocity);
+        units.pitch = note.pitch;
+        units.attributes = static_cast<juce::uint8>((note.accent & 3)
+                                                    | (note.active ? 1 << 2 : 0)
+                                                    | (note.isStaccato ? 1 << 3 : 0)
+                                                    | (note.isRest ? 1 << 4 : 0));
+        return units;
+    }
+
+    Note fromUnits(const NoteUnits& units, bool useTicks) noexcept
+    {
+        const auto toTime = [useTicks](juce::int64 value) {
+            return useTicks ? ticksToTime(value) : fromBits(static_cast<juce::uint32>(value));
+        };
+
+        Note note;
+        note.startTime = toTime(units.start);
+        note.duration = toTime(units.duration);
+        note.velocity = fromBits(units.velocity);
+        note.pitch = toInt(units.pitch);
+        note.accent = units.attributes & 3;
+        note.active = (units.attributes & (1 << 2)) != 0;
+        note.isStaccato = (units.attributes & (1 << 3)) != 0;
+        note.isRest = (units.attributes & (1 << 4)) != 0;
+        return note;
+    }
+
+    // Expects each note to repeat the last one, a step further on
+    struct Predictor {
+        NoteUnits last;
+        juce::int64 stride{0};
+
+        [[nodiscard]] NoteUnits predict() const noexcept
+        {
+            auto next = last;
+            next.start = wrapAdd(last.start, stride);
+            return next;
+        }
+
+        void advance(const NoteUnits& note) noexcept
+        {
+            stride = wrapSubtract(note.start, last.start);
+            last = note;
+        }
+    };
+
+    juce::uint8 getChanges(const NoteUnits& note, const NoteUnits& predicted) noexcept
+    {
+        return static_cast<juce::uint8>((note.start != predicted.start ? kStartChanged : 0)
+                                        | (note.duration != predicted.duration ? kDurationChanged : 0)
+                                        | (note.velocity != predicted.velocity ? kVelocityChanged : 0)
+                                        | (note.pitch != predicted.pitch ? kPitchChanged : 0)
+                                        | (note.attributes != predicted.attributes ? kAttributesChanged : 0));
+    }
+
+    void writeDelta(juce::OutputStream& out, juce::int64 value, juce::int64 predicted)
+    {
+        writeVarint(out, zigzagEncode(wrapSubtract(value, predicted)));
+    }
+
+    bool readDelta(ByteReader& reader, juce::int64& value)
+    {
+        juce::uint64 encoded = 0;
+        if (!reader.readVarint(encoded))
+            return false;
+        value = wrapAdd(value, zigzagDecode(encoded));
+        return true;
+    }
+}
+
+void PatternDeltaCodec::write(const Pattern& pattern, juce::OutputStream& out)
+{
+    const auto& notes = pattern.getNotes();
+
+    writeVarint(out, zigzagEncode(pattern.getLength()));
+    out.writeDouble(pattern.getTempo());
+    out.writeDouble(pattern.getGridSize());
+    writeVarint(out, notes.size());
+
+    const bool useTicks = std::all_of(notes.begin(), notes.end(), [](const Note& note) {
+        return isWholeTicks(note.startTime) && isWholeTicks(note.duration);
+    });
+    out.writeByte(static_cast<char>(useTicks ? kTickTimes : kFloatBitTimes));
+
+    Predictor predictor;
+    for (size_t i = 0; i < notes.size();)
+    {
+        const auto units = toUnits(notes[i], useTicks);
+        const auto predicted = predictor.predict();
+        const auto changes = getChanges(units, predicted);
+
+        if (changes == 0)
+        {
+            juce::uint64 run = 0;
+            for (; i < notes.size(); ++i, ++run)
+            {
+                const auto next = toUnits(notes[i], useTicks);
+                if (getChanges(next, predictor.predict()) != 0)
+                    break;
+                predictor.advance(next);
+            }
+
+            out.writeByte(0);
+            writeVarint(out, run);
+            continue;
+        }
+
+        out.writeByte(static_cast<char>(changes));
+        if (changes & kStartChanged)      writeDelta(out, units.start, predicted.start);
+        if (changes & kDurationChanged)   writeDelta(out, units.duration, predicted.duration);
+        if (changes & kVelocityChanged)   out.writeInt(static_cast<int>(units.velocity));
+        if (changes & kPitchChanged)      writeDelta(out, units.pitch, predicted.pitch);
+        if (changes & kAttributesChanged) out.writeByte(static_cast<char>(units.attributes));
+
+        predictor.advance(units);
+        ++i;
+    }
+}
+
+bool PatternDeltaCodec::read(ByteReader& reader, Pattern& result, ValidationReport& report)
+{
+    report = {};
+    const auto fail = [&report] {
+        report.error = ValidationError::Truncated;
+        return false;
+    };
+
+    juce::uint64 length = 0;
+    juce::uint64 noteCount = 0;
+    double tempo = 0.0;
+    double gridSize = 0.0;
+    juce::uint8 timeMode = 0;
+    if (!reader.readVarint(length) || !reader.readDouble(tempo) || !reader.readDouble(gridSize)
+        || !reader.readVarint(noteCount) || !reader.readUInt8(timeMode)
+        || noteCount > kMaxNotes || timeMode > kFloatBitTimes)
+        return fail();
+
+    const bool useTicks = timeMode == kTickTimes;
+    std::vector<Note> notes;
+    notes.reserve(static_cast<size_t>(noteCount));
+
+    Predictor predictor;
+    while (notes.size() < noteCount)
+    {
+        juce::uint8 changes = 0;
+        if (!reader.readUInt8(changes) || (changes & ~kAllChanges) != 0)
+            return fail();
+
+        if (changes == 0)
+        {
+            juce::uint64 run = 0;
+            if (!reader.readVarint(run) || run == 0 || run > noteCount - notes.size())
+                return fail();
+
+            for (; run > 0; --run)
+            {
+                const auto units = predictor.predict();
+                predictor.advance(units);
+                notes.push_back(fromUnits(units, useTicks));
+            }
+            continue;
+        }
+
+        auto units = predictor.predict();
+        if ((changes & kStartChanged) && !readDelta(reader, units.start))
+            return fail();
+        if ((changes & kDurationChanged) && !readDelta(reader, units.duration))
+            return fail();
+        if ((changes & kVelocityChanged) && !reader.readUInt32(units.velocity))
+            return fail();
+        if ((changes & kPitchChanged) && !readDelta(reader, units.pitch))
+            return fail();
+        if ((changes & kAttributesChanged) && !reader.readUInt8(units.attributes))
+            return fail();
+
+        predictor.advance(units);
+        notes.push_back(fromUnits(units, useTicks));
+    }
+
+    return Pattern::tryCreate(toInt(zigzagDecode(length)), tempo, gridSize, std::move(notes), result, report,
+                              PatternCheck::Structural);
+}
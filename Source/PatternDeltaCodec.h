@@ -0,0 +1,41 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Pattern.h"
+
+/**
+ * @brief Compact delta and run-length encoding of a pattern, for plugin state
+ *
+ * Each note is predicted from the one before it: the start advances by the
+ * previous spacing and every other field repeats. A note is written as a
+ * byte saying which fields missed the prediction, followed by just those
+ * fields (times and pitch as zigzag varint deltas); a run of notes that all
+ * match is a zero byte and a count. An evenly spaced grid pattern with a
+ * fixed pitch therefore costs a few bytes in total.
+ *
+ * Times are encoded in 1/960 beat ticks when every note's times convert
+ * exactly, and as their float bit patterns otherwise, so decoding is always
+ * lossless.
+ *
+ *   varint   zigzag length
+ *   float64  tempo
+ *   float64  gridSize
+ *   varint   noteCount
+ *   uint8    time mode: 0 ticks, 1 float bits
+ *   records  until noteCount notes are read
+ */
+namespace PatternDeltaCodec {
+    constexpr juce::int64 kTicksPerBeat = 960;
+
+    void write(const Pattern& pattern, juce::OutputStream& out);
+
+    /**
+     * @brief Decodes a pattern written by write(), without throwing
+     *
+     * Only structural checks apply (PatternCheck::Structural): state restores
+     * what was saved, including notes that run past the pattern's length.
+     * @param report Receives Truncated for damaged data, or the pattern's problems
+     * @return False, leaving result untouched, if the data is not a valid pattern
+     */
+    bool read(PatternFormat::ByteReader& reader, Pattern& result, ValidationReport& report);
+}
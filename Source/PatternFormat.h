@@ -0,0 +1,220 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstring>
+
+/**
+ * @brief Layout of the binary pattern format
+ *
+ * Every value is little-endian. A file starts with a fixed header, followed
+ * by noteCount fixed-size note records, followed by an optional metadata
+ * trailer (see PatternEntry). Readers honour headerSize and noteSize rather
+ * than the constants below, so a later version can grow either without
+ * breaking them; a version they don't know is rejected.
+ *
+ *   Header, 40 bytes
+ *     0   char[4]  magic "GSPB"
+ *     4   uint16   version
+ *     6   uint16   headerSize
+ *     8   uint32   noteCount
+ *     12  uint32   noteSize
+ *     16  int32    length (beats)
+ *     20  uint32   reserved, written as 0
+ *     24  float64  tempo (BPM)
+ *     32  float64  gridSize (beats)
+ *
+ *   Note record, 16 bytes
+ *     0   float32  startTime (beats)
+ *     4   float32  duration (beats)
+ *     8   float32  velocity
+ *     12  uint8    pitch
+ *     13  uint8    accent
+ *     14  uint8    flags: active, staccato, rest from bit 0
+ *     15  uint8    reserved, written as 0
+ *
+ * Records are 4-byte aligned from the start of the file, so a mapped file
+ * can be decoded in place.
+ */
+namespace PatternFormat {
+    constexpr char kMagic[4] = { 'G', 'S', 'P', 'B' };
+    constexpr juce::uint16 kVersion = 1;
+
+    constexpr size_t kHeaderSize = 40;
+    constexpr size_t kNoteSize = 16;
+
+    constexpr juce::uint8 kActiveFlag = 1 << 0;
+    constexpr juce::uint8 kStaccatoFlag = 1 << 1;
+    constexpr juce::uint8 kRestFlag = 1 << 2;
+
+    // File extension of binary patterns; ".pattern" JSON is kept for import and export
+    constexpr const char* kFileExtension = ".gsp";
+
+    /**
+     * @brief Bounds-checked little-endian cursor over a byte range
+     *
+     * Every read either succeeds and advances or fails and leaves the cursor
+     * where it was, so a decoder can stop at the first failure.
+     */
+    class ByteReader {
+    public:
+        ByteReader(const void* sourceData, size_t sourceSize) noexcept
+            : data(static_cast<const juce::uint8*>(sourceData))
+            , size(sourceData != nullptr ? sourceSize : 0)
+        {
+        }
+
+        [[nodiscard]] size_t getPosition() const noexcept { return position; }
+        [[nodiscard]] size_t getRemaining() const noexcept { return size - position; }
+        [[nodiscard]] bool canRead(size_t numBytes) const noexcept { return numBytes <= getRemaining(); }
+
+        // Start of the next numBytes, or nullptr if they run past the end
+        const juce::uint8* read(size_t numBytes) noexcept {
+            if (!canRead(numBytes))
+                return nullptr;
+            const auto* start = data + position;
+            position += numBytes;
+            return start;
+        }
+
+        bool skip(size_t numBytes) noexcept { return read(numBytes) != nullptr; }
+
+        bool readUInt8(juce::uint8& value) noexcept {
+            const auto* bytes = read(1);
+            if (bytes == nullptr) return false;
+            value = bytes[0];
+            return true;
+        }
+
+        bool readUInt16(juce::uint16& value) noexcept {
+            const auto* bytes = read(2);
+            if (bytes == nullptr) return false;
+            value = juce::ByteOrder::littleEndianShort(bytes);
+            return true;
+        }
+
+        bool readUInt32(juce::uint32& value) noexcept {
+            const auto* bytes = read(4);
+            if (bytes == nullptr) return false;
+            value = juce::ByteOrder::littleEndianInt(bytes);
+            return true;
+        }
+
+        bool readInt64(juce::int64& value) noexcept {
+            const auto* bytes = read(8);
+            if (bytes == nullptr) return false;
+            value = static_cast<juce::int64>(juce::ByteOrder::littleEndianInt64(bytes));
+            return true;
+        }
+
+        bool readFloat(float& value) noexcept;
+        bool readDouble(double& value) noexcept;
+
+        // Unsigned LEB128, at most ten bytes
+        bool readVarint(juce::uint64& value) noexcept {
+            const auto start = position;
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const auto* byte = read(1);
+                if (byte == nullptr)
+                    break;
+                value |= static_cast<juce::uint64>(*byte & 0x7f) << shift;
+                if ((*byte & 0x80) == 0)
+                    return true;
+            }
+            position = start;
+            return false;
+        }
+
+        // UTF-8 text preceded by its byte count as a uint32
+        bool readString(juce::String& value) {
+            const auto start = position;
+            juce::uint32 numBytes = 0;
+            const juce::uint8* bytes = nullptr;
+            if (!readUInt32(numBytes) || (bytes = read(numBytes)) == nullptr) {
+                position = start;
+                return false;
+            }
+            value = juce::String::fromUTF8(reinterpret_cast<const char*>(bytes), static_cast<int>(numBytes));
+            return true;
+        }
+
+    private:
+        const juce::uint8* data;
+        size_t size;
+        size_t position{0};
+    };
+
+    // Decoders for fields already known to be in range
+    inline juce::int32 readInt32(const juce::uint8* bytes) noexcept {
+        return static_cast<juce::int32>(juce::ByteOrder::littleEndianInt(bytes));
+    }
+
+    inline float readFloat(const juce::uint8* bytes) noexcept {
+        const auto bits = juce::ByteOrder::littleEndianInt(bytes);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline double readDouble(const juce::uint8* bytes) noexcept {
+        const auto bits = juce::ByteOrder::littleEndianInt64(bytes);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline bool ByteReader::readFloat(float& value) noexcept {
+        const auto* bytes = read(4);
+        if (bytes == nullptr) return false;
+        value = PatternFormat::readFloat(bytes);
+        return true;
+    }
+
+    inline bool ByteReader::readDouble(double& value) noexcept {
+        const auto* bytes = read(8);
+        if (bytes == nullptr) return false;
+        value = PatternFormat::readDouble(bytes);
+        return true;
+    }
+
+    inline void writeVarint(juce::OutputStream& out, juce::uint64 value) {
+        while (value >= 0x80) {
+            out.writeByte(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.writeByte(static_cast<char>(value));
+    }
+
+    // Maps signed values to unsigned so small magnitudes of either sign stay short as varints
+    constexpr juce::uint64 zigzagEncode(juce::int64 value) noexcept {
+        return (static_cast<juce::uint64>(value) << 1) ^ static_cast<juce::uint64>(value >> 63);
+    }
+
+    constexpr juce::int64 zigzagDecode(juce::uint64 value) noexcept {
+        return static_cast<juce::int64>(value >> 1) ^ -static_cast<juce::int64>(value & 1);
+    }
+
+    /**
+     * @brief Calls read(data, size) on a file's contents and returns its result
+     *
+     * The file is memory-mapped where possible, so it is never copied; if
+     * mapping fails it is read into memory instead.
+     */
+    template <typename Reader>
+    auto readFileData(const juce::File& file, Reader&& read) {
+        juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+        if (mapped.getData() != nullptr)
+            return read(mapped.getData(), mapped.getSize());
+
+        juce::MemoryBlock data;
+        file.loadFileAsData(data);
+        return read(data.getData(), data.getSize());
+    }
+
+    inline void writeString(juce::OutputStream& out, const juce::String& value) {
+        const auto utf8 = value.toUTF8();
+        const auto numBytes = utf8.sizeInBytes() - 1;
+        out.writeInt(static_cast<int>(numBytes));
+        out.write(utf8.getAddress(), numBytes);
+    }
+}
@@ -0,0 +1,174 @@
+#include "PatternHistory.h"
+#include <algorithm>
+
+namespace {
+    // Rough size of the control block make_shared places in front of a chunk
+    constexpr size_t kControlBlockBytes = 2 * sizeof(void*);
+}
+
+PatternHistory::PatternHistory(size_t memoryLimitBytes)
+    : memoryLimit(memoryLimitBytes)
+{
+}
+
+void PatternHistory::reset(const Pattern& pattern)
+{
+    entries.clear();
+    entries.push_back(makeEntry(pattern, nullptr));
+    current = 0;
+    memoryUsage = entries.back().ownBytes;
+}
+
+bool PatternHistory::record(const Pattern& pattern)
+{
+    if (entries.empty())
+    {
+        reset(pattern);
+        return true;
+    }
+
+    auto entry = makeEntry(pattern, &entries[static_cast<size_t>(current)]);
+    if (hasSameContents(entry, entries[static_cast<size_t>(current)]))
+        return false;
+
+    while (canRedo())
+        dropNewest();
+
+    memoryUsage += entry.ownBytes;
+    entries.push_back(std::move(entry));
+    ++current;
+
+    trimToLimit();
+    return true;
+}
+
+bool PatternHistory::undo(Pattern& result)
+{
+    return canUndo() && jumpTo(current - 1, result);
+}
+
+bool PatternHistory::redo(Pattern& result)
+{
+    return canRedo() && jumpTo(current + 1, result);
+}
+
+bool PatternHistory::jumpTo(int index, Pattern& result)
+{
+    if (!juce::isPositiveAndBelow(index, getNumEntries()))
+        return false;
+
+    result = restore(entries[static_cast<size_t>(index)]);
+    current = index;
+    return true;
+}
+
+void PatternHistory::setMemoryLimit(size_t newLimitBytes)
+{
+    memoryLimit = newLimitBytes;
+    trimToLimit();
+}
+
+size_t PatternHistory::getChunkBytes(const Chunk& chunk) noexcept
+{
+    return kControlBlockBytes + sizeof(Chunk) + chunk.capacity() * sizeof(Note);
+}
+
+size_t PatternHistory::getTableBytes(const Entry& entry) noexcept
+{
+    return sizeof(Entry) + entry.chunks.capacity() * sizeof(ChunkPtr);
+}
+
+bool PatternHistory::hasSameContents(const Entry& entry, const Entry& other) noexcept
+{
+    // makeEntry reuses every unchanged chunk, so equal notes mean equal pointers
+    return entry.numNotes == other.numNotes
+        && entry.length == other.length
+        && entry.tempo == other.tempo
+        && entry.gridSize == other.gridSize
+        && entry.chunks == other.chunks;
+}
+
+PatternHistory::Entry PatternHistory::makeEntry(const Pattern& pattern, const Entry* previous) const
+{
+    const auto& notes = pattern.getNotes();
+
+    Entry entry;
+    entry.numNotes = notes.size();
+    entry.length = pattern.getLength();
+    entry.tempo = pattern.getTempo();
+    entry.gridSize = pattern.getGridSize();
+    entry.chunks.reserve((notes.size() + kNotesPerChunk - 1) / kNotesPerChunk);
+
+    size_t sharedBytes = 0;
+    size_t ownChunkBytes = 0;
+
+    for (size_t start = 0; start < notes.size(); start += kNotesPerChunk)
+    {
+        const auto first = notes.begin() + static_cast<std::ptrdiff_t>(start);
+        const auto last = notes.begin() + static_cast<std::ptrdiff_t>(std::min(notes.size(), start + kNotesPerChunk));
+        const size_t index = entry.chunks.size();
+
+        // Only the chunk at the same index is compared, so edits are cheapest when
+        // they leave the notes before them in place
+        if (previous != nullptr && index < previous->chunks.size())
+        {
+            const auto& candidate = previous->chunks[index];
+            if (std::equal(first, last, candidate->begin(), candidate->end()))
+            {
+                entry.chunks.push_back(candidate);
+                sharedBytes += getChunkBytes(*candidate);
+                continue;
+            }
+        }
+
+        auto chunk = std::make_shared<const Chunk>(first, last);
+        ownChunkBytes += getChunkBytes(*chunk);
+        entry.chunks.push_back(std::move(chunk));
+    }
+
+    entry.ownBytes = getTableBytes(entry) + ownChunkBytes;
+    entry.totalBytes = entry.ownBytes + sharedBytes;
+    return entry;
+}
+
+Pattern PatternHistory::restore(const Entry& entry) const
+{
+    std::vector<Note> notes;
+    notes.reserve(entry.numNotes);
+    for (const auto& chunk : entry.chunks)
+        notes.insert(notes.end(), chunk->begin(), chunk->end());
+
+    Pattern pattern(entry.length, entry.tempo, entry.gridSize);
+    pattern.setNotes(std::move(notes));
+    return pattern;
+}
+
+void PatternHistory::dropOldest()
+{
+    memoryUsage -= entries.front().ownBytes;
+    entries.pop_front();
+    --current;
+
+    // The new oldest entry now holds alone the chunks it shared with the dropped one
+    if (!entries.empty())
+    {
+        auto& oldest = entries.front();
+        memoryUsage += oldest.totalBytes - oldest.ownBytes;
+        oldest.ownBytes = oldest.totalBytes;
+    }
+}
+
+void PatternHistory::dropNewest()
+{
+    memoryUsage -= entries.back().ownBytes;
+    entries.pop_back();
+}
+
+void PatternHistory::trimToLimit()
+{
+    while (memoryUsage > memoryLimit && canUndo())
+        dropOldest();
+
+    while (memoryUsage > memoryLimit && canRedo())
+        dropNewest();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Pattern.h"
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Bounded undo/redo history of a pattern
+ *
+ * Each entry stores the pattern's notes as a table of fixed-size chunks held
+ * by shared pointer. Recording a state reuses every chunk that is unchanged
+ * from the current entry, so an edit costs the chunks it touched plus the
+ * chunk table rather than a copy of every note. Entries sit in a deque, so
+ * any history point is found by index in constant time; restoring it copies
+ * its notes into a fresh pattern.
+ *
+ * Memory is accounted per entry as the bytes it added over its predecessor.
+ * When the total exceeds the limit the oldest entries are dropped, and the
+ * chunks they shared with the next entry are charged to that entry instead.
+ *
+ * Not thread-safe: the processor uses it under its pattern lock.
+ */
+class PatternHistory {
+public:
+    static constexpr size_t kNotesPerChunk = 32;
+    static constexpr size_t kDefaultMemoryLimit = 4 * 1024 * 1024;
+
+    explicit PatternHistory(size_t memoryLimitBytes = kDefaultMemoryLimit);
+
+    // Forgets every entry and starts again from this pattern
+    void reset(const Pattern& pattern);
+
+    /**
+     * @brief Records a new state after the current one, discarding the redo entries
+     * @return False if the pattern is identical to the current entry and nothing was recorded
+     */
+    bool record(const Pattern& pattern);
+
+    [[nodiscard]] bool canUndo() const noexcept { return current > 0; }
+    [[nodiscard]] bool canRedo() const noexcept { return current + 1 < getNumEntries(); }
+
+    // Each moves the current entry and writes its pattern to result; false leaves both alone
+    bool undo(Pattern& result);
+    bool redo(Pattern& result);
+    bool jumpTo(int index, Pattern& result);
+
+    [[nodiscard]] int getNumEntries() const noexcept { return static_cast<int>(entries.size()); }
+    [[nodiscard]] int getCurrentIndex() const noexcept { return current; }
+
+    [[nodiscard]] size_t getMemoryUsage() const noexcept { return memoryUsage; }
+    [[nodiscard]] size_t getMemoryLimit() const noexcept { return memoryLimit; }
+
+    // Drops entries immediately if the history no longer fits; the current entry is always kept
+    void setMemoryLimit(size_t newLimitBytes);
+
+private:
+    using Chunk = std::vector<Note>;
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+
+    struct Entry {
+        std::vector<ChunkPtr> chunks;
+        size_t numNotes{0};
+        int length{16};
+        double tempo{120.0};
+        double gridSize{0.25};
+        size_t ownBytes{0};      // Table plus the chunks not shared with the previous entry
+        size_t totalBytes{0};    // Table plus every chunk
+    };
+
+    static size_t getChunkBytes(const Chunk& chunk) noexcept;
+    static size_t getTableBytes(const Entry& entry) noexcept;
+    static bool hasSameContents(const Entry& entry, const Entry& other) noexcept;
+
+    Entry makeEntry(const Pattern& pattern, const Entry* previous) const;
+    Pattern restore(const Entry& entry) const;
+
+    void dropOldest();
+    void dropNewest();
+    void trimToLimit();
+
+    std::deque<Entry> entries;
+    int current{-1};
+    size_t memoryUsage{0};
+    size_t memoryLimit;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatternHistory)
+};
@@ -0,0 +1,514 @@
+#include "PatternJsonReader.h"
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace {
+    constexpr int kMaxDepth = 64;
+    constexpr size_t kMaxNumberLength = 64;
+
+    /**
+     * Callback-driven JSON reader over a byte range. readObject() hands each
+     * member's key to a handler, which must consume the value with one of the
+     * read or skip calls; readArray() calls its handler once per element. Keys
+     * are decoded into one reused buffer, valid until the handler reads the
+     * value. Every call returns false on malformed input.
+     */
+    class JsonEventReader {
+    public:
+        JsonEventReader(const void* data, size_t size) noexcept
+            : pos(static_cast<const char*>(data))
+            , end(pos + (data != nullptr ? size : 0))
+        {
+            // Skip a UTF-8 byte order mark
+            if (end - pos >= 3 && pos[0] == '\xEF' && pos[1] == '\xBB' && pos[2] == '\xBF')
+                pos += 3;
+        }
+
+        // First character of the next value, or 0 at the end of the input
+        char peek() noexcept
+        {
+            skipWhitespace();
+            return pos < end ? *pos : 0;
+        }
+
+        bool isAtEnd() noexcept
+        {
+            skipWhitespace();
+            return pos == end;
+        }
+
+        template <typename Handler>
+        bool readObject(Handler&& onMember)
+        {
+            if (!consume('{') || ++depth > kMaxDepth)
+                return false;
+
+            if (!consume('}'))
+            {
+                do
+                {
+                    if (peek() != '"' || !readRawString(key) || !consume(':') || !onMember(key))
+                        return false;
+                } while (consume(','));
+
+                if (!consume('}'))
+                    return false;
+            }
+
+            --depth;
+            return true;
+        }
+
+        template <typename Handler>
+        bool readArray(Handler&& onElement)
+        {
+            if (!consume('[') || ++depth > kMaxDepth)
+                return false;
+
+            if (!consume(']'))
+            {
+                do
+                {
+                    if (!onElement())
+                        return false;
+                } while (consume(','));
+
+                if (!consume(']'))
+                    return false;
+            }
+
+            --depth;
+            return true;
+        }
+
+        // Reads true and false as 1 and 0, and any other non-number as 0, as var does
+        bool readNumber(double& value)
+        {
+            const char c = peek();
+            if (c == 't' || c == 'f')
+            {
+                bool flag = false;
+                if (!readBool(flag))
+                    return false;
+                value = flag ? 1.0 : 0.0;
+                return true;
+            }
+
+            if (c != '-' && !isDigit(c))
+            {
+                value = 0.0;
+                return skipValue();
+            }
+
+            const char* start = pos;
+            if (!scanNumber())
+                return false;
+
+            const auto length = static_cast<size_t>(pos - start);
+            if (length >= kMaxNumberLength)
+                return false;
+
+            char buffer[kMaxNumberLength];
+            std::memcpy(buffer, start, length);
+            buffer[length] = 0;
+
+            juce::CharPointer_UTF8 text(buffer);
+            value = juce::CharacterFunctions::readDoubleValue(text);
+            return true;
+        }
+
+        // Reads a non-string as an empty string
+        bool readString(juce::String& value)
+        {
+            if (peek() != '"')
+            {
+                value = {};
+                return skipValue();
+            }
+
+            if (!readRawString(text))
+                return false;
+
+            value = juce::String::fromUTF8(text.data(), static_cast<int>(text.size()));
+            return true;
+        }
+
+        bool skipValue()
+        {
+            switch (peek())
+            {
+                case '{': return readObject([this](const std::string&) { return skipValue(); });
+                case '[': return readArray([this] { return skipValue(); });
+                case '"': return readRawString(text);
+                case 't':
+                case 'f': { bool flag = false; return readBool(flag); }
+                case 'n': return readLiteral("null");
+                default:  { double number = 0.0; return (peek() == '-' || isDigit(peek())) && readNumber(number); }
+            }
+        }
+
+    private:
+        static bool isDigit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+        void skipWhitespace() noexcept
+        {
+            while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t'))
+                ++pos;
+        }
+
+        bool consume(char expected) noexcept
+        {
+            skipWhitespace();
+            if (pos < end && *pos == expected)
+            {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+
+        bool readLiteral(const char* literal) noexcept
+        {
+            const auto length = std::strlen(literal);
+            if (static_cast<size_t>(end - pos) < length || std::memcmp(pos, literal, length) != 0)
+                return false;
+            pos += length;
+            return true;
+        }
+
+        bool readBool(bool& value) noexcept
+        {
+            value = peek() == 't';
+            return readLiteral(value ? "true" : "false");
+        }
+
+        size_t skipDigits() noexcept
+        {
+            const char* start = pos;
+            while (pos < end && isDigit(*pos))
+                ++pos;
+            return static_cast<size_t>(pos - start);
+        }
+
+        // Moves past a number in JSON's grammar
+        bool scanNumber() noexcept
+        {
+            if (pos < end && *pos == '-')
+                ++pos;
+            if (skipDigits() == 0)
+                return false;
+
+            if (pos < end && *pos == '.')
+            {
+                ++pos;
+                if (skipDigits() == 0)
+                    return false;
+            }
+
+            if (pos < end && (*pos == 'e' || *pos == 'E'))
+            {
+                ++pos;
+                if (pos < end && (*pos == '+' || *pos == '-'))
+                    ++pos;
+                if (skipDigits() == 0)
+                    return false;
+            }
+            return true;
+        }
+
+        bool readHex4(juce::uint32& value) noexcept
+        {
+            if (end - pos < 4)
+                return false;
+
+            value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                const int digit = juce::CharacterFunctions::getHexDigitValue(static_cast<juce::juce_wchar>(*pos++));
+                if (digit < 0)
+                    return false;
+                value = (value << 4) | static_cast<juce::uint32>(digit);
+            }
+            return true;
+        }
+
+        static void appendUtf8(std::string& out, juce::uint32 codePoint)
+        {
+            if (codePoint < 0x80)
+            {
+                out += static_cast<char>(codePoint);
+            }
+            else if (codePoint < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        // Decodes the string at pos into out as UTF-8, copying unescaped runs whole
+        bool readRawString(std::string& out)
+        {
+            out.clear();
+            ++pos;
+
+            for (;;)
+            {
+                const char* run = pos;
+                while (pos < end && *pos != '"' && *pos != '\\' && static_cast<unsigned char>(*pos) >= 0x20)
+                    ++pos;
+                out.append(run, static_cast<size_t>(pos - run));
+
+                if (pos == end || static_cast<unsigned char>(*pos) < 0x20)
+                    return false;
+
+                if (*pos++ == '"')
+                    return true;
+
+                if (pos == end)
+                    return false;
+
+                switch (*pos++)
+                {
+                    case '"':  out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/':  out += '/'; break;
+                    case 'b':  out += '\b'; break;
+                    case 'f':  out += '\f'; break;
+                    case 'n':  out += '\n'; break;
+                    case 'r':  out += '\r'; break;
+                    case 't':  out += '\t'; break;
+                    case 'u':
+                    {
+                        juce::uint32 codePoint = 0;
+                        if (!readHex4(codePoint))
+                            return false;
+
+                        // Combine a surrogate pair; a lone surrogate becomes U+FFFD
+                        if (codePoint >= 0xD800 && codePoint < 0xDC00)
+                        {
+                            juce::uint32 low = 0;
+                            if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+                            {
+                                codePoint = 0xFFFD;
+                            }
+                            else
+                            {
+                                pos += 2;
+                                if (!readHex4(low))
+                                    return false;
+                                codePoint = (low >= 0xDC00 && low < 0xE000)
+                                              ? 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00)
+                                              : 0xFFFD;
+                            }
+                        }
+                        else if (codePoint >= 0xDC00 && codePoint < 0xE000)
+                        {
+                            codePoint = 0xFFFD;
+                        }
+
+                        appendUtf8(out, codePoint);
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+        }
+
+        const char* pos;
+        const char* end;
+        int depth{0};
+        std::string key;
+        std::string text;
+    };
+
+    // Fields of a pattern object, turned into a Pattern once the whole document has parsed
+    struct PatternFields {
+        int length{0};
+        double tempo{0.0};
+        double gridSize{0.0};
+        std::vector<Note> notes;
+    };
+
+    // Truncates like var's double-to-int conversion, without overflowing
+    int toInt(double value) noexcept
+    {
+        if (std::isnan(value))
+            return 0;
+
+        return static_cast<int>(juce::jlimit(static_cast<double>(std::numeric_limits<int>::min()),
+                                             static_cast<double>(std::numeric_limits<int>::max()),
+                                             value));
+    }
+
+    bool readNote(JsonEventReader& reader, Note& note)
+    {
+        // Note::fromVarUnchecked leaves a non-object at the defaults, and reads
+        // a missing property of an object as zero
+        if (reader.peek() != '{')
+            return reader.skipValue();
+
+        note.pitch = 0;
+        note.velocity = 0.0f;
+        note.startTime = 0.0f;
+        note.duration = 0.0f;
+        note.accent = 0;
+        note.active = false;
+        note.isStaccato = false;
+        note.isRest = false;
+
+        return reader.readObject([&reader, &note](const std::string& key) {
+            double value = 0.0;
+            if (!reader.readNumber(value))
+                return false;
+
+            if (key == "pitch")           note.pitch = toInt(value);
+            else if (key == "velocity")   note.velocity = static_cast<float>(value);
+            else if (key == "startTime")  note.startTime = static_cast<float>(value);
+            else if (key == "duration")   note.duration = static_cast<float>(value);
+            else if (key == "accent")     note.accent = toInt(value);
+            else if (key == "active")     note.active = value != 0.0;
+            else if (key == "isStaccato") note.isStaccato = value != 0.0;
+            else if (key == "isRest")     note.isRest = value != 0.0;
+            return true;
+        });
+    }
+
+    bool parsePattern(JsonEventReader& reader, PatternFields& fields)
+    {
+        return reader.readObject([&reader, &fields](const std::string& key) {
+            if (key == "notes")
+            {
+                fields.notes.clear();
+                if (reader.peek() != '[')
+                    return reader.skipValue();
+
+                return reader.readArray([&reader, &fields] {
+                    fields.notes.emplace_back();
+                    return readNote(reader, fields.notes.back());
+                });
+            }
+
+            double value = 0.0;
+            if (!reader.readNumber(value))
+                return false;
+
+            if (key == "length")        fields.length = toInt(value);
+            else if (key == "tempo")    fields.tempo = value;
+            else if (key == "gridSize") fields.gridSize = value;
+            return true;
+        });
+    }
+
+    bool createPattern(PatternFields& fields, Pattern& result, ValidationReport& report)
+    {
+        return Pattern::tryCreate(fields.length, fields.tempo, fields.gridSize, std::move(fields.notes), result, report);
+    }
+}
+
+bool PatternJsonReader::readPattern(const void* data, size_t size, Pattern& result, ValidationReport& report)
+{
+    report = {};
+    JsonEventReader reader(data, size);
+    if (reader.peek() != '{')
+    {
+        report.error = ValidationError::NotAnObject;
+        return false;
+    }
+
+    PatternFields fields;
+    if (!parsePattern(reader, fields) || !reader.isAtEnd())
+    {
+        report.error = ValidationError::MalformedJson;
+        return false;
+    }
+
+    return createPattern(fields, result, report);
+}
+
+bool PatternJsonReader::readEntry(const void* data, size_t size, PatternEntry& result, ValidationReport& report)
+{
+    report = {};
+    JsonEventReader reader(data, size);
+    if (reader.peek() != '{')
+    {
+        report.error = ValidationError::NotAnObject;
+        return false;
+    }
+
+    PatternEntry entry;
+    PatternFields fields;
+    bool hasPattern = false;
+    bool patternIsObject = false;
+    bool hasModified = false;
+    double modified = 0.0;
+
+    const bool parsed = reader.readObject([&](const std::string& key) {
+        if (key == "name")  return reader.readString(entry.name);
+        if (key == "type")  return reader.readString(entry.type);
+        if (key == "style") return reader.readString(entry.style);
+
+        // A null is treated as missing, as with a void var
+        if (reader.peek() == 'n')
+            return reader.skipValue();
+
+        if (key == "modified")
+        {
+            hasModified = true;
+            return reader.readNumber(modified);
+        }
+
+        if (key == "pattern")
+        {
+            hasPattern = true;
+            patternIsObject = reader.peek() == '{';
+            fields = {};
+            return patternIsObject ? parsePattern(reader, fields) : reader.skipValue();
+        }
+
+        return reader.skipValue();
+    });
+
+    if (!parsed || !reader.isAtEnd())
+    {
+        report.error = ValidationError::MalformedJson;
+        return false;
+    }
+
+    entry.modified = hasModified ? juce::Time(static_cast<juce::int64>(modified)) : juce::Time::getCurrentTime();
+
+    if (hasPattern)
+    {
+        if (!patternIsObject)
+        {
+            report.error = ValidationError::NotAnObject;
+            return false;
+        }
+
+        if (!createPattern(fields, entry.pattern, report))
+            return false;
+    }
+
+    if (!entry.validate())
+    {
+        report.error = ValidationError::InvalidMetadata;
+        return false;
+    }
+
+    result = std::move(entry);
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Models/PatternEntry.h"
+
+/**
+ * @brief Streaming reader for ".pattern" JSON files
+ *
+ * Parses the bytes of a file straight into PatternEntry and Note fields in a
+ * single pass, without building a juce::var tree or copying the text into a
+ * juce::String, so the data can come from a memory-mapped file. Unknown keys
+ * are skipped. Fields map exactly as in PatternEntry::tryFromVar, including
+ * its defaults for missing ones, so both paths accept the same files.
+ */
+namespace PatternJsonReader {
+    /**
+     * @brief Reads an entry as written by PatternEntry::toVar and juce::JSON
+     * @param report Receives MalformedJson for bad syntax, or the pattern's problems
+     * @return False, leaving result untouched, if the data is not a valid entry
+     */
+    bool readEntry(const void* data, size_t size, PatternEntry& result, ValidationReport& report);
+
+    // Reads a bare pattern object as written by Pattern::toVar
+    bool readPattern(const void* data, size_t size, Pattern& result, ValidationReport& report);
+}
@@ -0,0 +1,367 @@
+#include "PatternPack.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace {
+    // Field offsets within an index record
+    constexpr size_t kPayloadOffsetField = 0;
+    constexpr size_t kPayloadSizeField = 8;
+    constexpr size_t kModifiedField = 16;
+    constexpr size_t kContentHashField = 24;
+    constexpr size_t kNameField = 32;
+    constexpr size_t kTypeField = 40;
+    constexpr size_t kStyleField = 48;
+
+    constexpr size_t kPayloadAlignment = 8;
+
+    juce::uint64 hashPayload(const void* data, size_t size) noexcept
+    {
+        auto hash = static_cast<juce::uint64>(14695981039346656037ull);
+        const auto* bytes = static_cast<const juce::uint8*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= static_cast<juce::uint64>(1099511628211ull);
+        }
+        return hash;
+    }
+
+    // Checks offset + size <= limit without overflowing
+    bool fitsWithin(juce::uint64 offset, juce::uint64 size, size_t limit) noexcept
+    {
+        return offset <= limit && size <= limit - offset;
+    }
+
+    size_t alignUp(size_t value) noexcept
+    {
+        return (value + kPayloadAlignment - 1) & ~(kPayloadAlignment - 1);
+    }
+
+    struct StringRef {
+        juce::uint32 offset{0};
+        juce::uint32 size{0};
+    };
+}
+
+std::unique_ptr<PatternPack> PatternPack::tryOpen(const juce::File& file, ValidationReport& report)
+{
+    report = {};
+    std::unique_ptr<PatternPack> pack(new PatternPack());
+    pack->file = file;
+
+    // Map the file so entries are paged in only when read; fall back to reading it
+    pack->mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    if (pack->mappedFile->getData() != nullptr)
+    {
+        pack->data = static_cast<const juce::uint8*>(pack->mappedFile->getData());
+        pack->dataSize = pack->mappedFile->getSize();
+    }
+    else
+    {
+        pack->mappedFile.reset();
+        file.loadFileAsData(pack->loadedData);
+        pack->data = static_cast<const juce::uint8*>(pack->loadedData.getData());
+        pack->dataSize = pack->loadedData.getSize();
+    }
+
+    const auto* bytes = pack->data;
+    const auto size = pack->dataSize;
+    if (bytes == nullptr || size < sizeof(kMagic) || std::memcmp(bytes, kMagic, sizeof(kMagic)) != 0)
+    {
+        report.error = ValidationError::NotPatternPack;
+        return nullptr;
+    }
+    if (size < kHeaderSize)
+    {
+        report.error = ValidationError::Truncated;
+        return nullptr;
+    }
+
+    const auto version = juce::ByteOrder::littleEndianShort(bytes + 4);
+    if (version == 0 || version > kVersion)
+    {
+        report.error = ValidationError::UnsupportedVersion;
+        return nullptr;
+    }
+
+    const size_t headerSize = juce::ByteOrder::littleEndianShort(bytes + 6);
+    const size_t entryCount = juce::ByteOrder::littleEndianInt(bytes + 8);
+    const size_t recordSize = juce::ByteOrder::littleEndianInt(bytes + 12);
+    const auto stringsOffset = juce::ByteOrder::littleEndianInt64(bytes + 16);
+    const auto stringsSize = juce::ByteOrder::littleEndianInt64(bytes + 24);
+    if (headerSize < kHeaderSize || recordSize < kIndexRecordSize)
+    {
+        report.error = ValidationError::CorruptHeader;
+        return nullptr;
+    }
+
+    // Checked once here, so reading the index needs no bounds checks of its own
+    if (headerSize > size || entryCount > (size - headerSize) / recordSize
+        || !fitsWithin(stringsOffset, stringsSize, size))
+    {
+        report.error = ValidationError::Truncated;
+        return nullptr;
+    }
+
+    pack->entryCount = entryCount;
+    pack->indexOffset = headerSize;
+    pack->indexRecordSize = recordSize;
+    pack->stringsOffset = static_cast<size_t>(stringsOffset);
+    pack->stringsSize = static_cast<size_t>(stringsSize);
+    return pack;
+}
+
+const juce::uint8* PatternPack::getRecord(int index) const noexcept
+{
+    if (index < 0 || static_cast<size_t>(index) >= entryCount)
+        return nullptr;
+
+    return data + indexOffset + static_cast<size_t>(index) * indexRecordSize;
+}
+
+juce::String PatternPack::getString(int index, size_t fieldOffset) const
+{
+    const auto* record = getRecord(index);
+    if (record == nullptr)
+        return {};
+
+    const auto offset = juce::ByteOrder::littleEndianInt(record + fieldOffset);
+    const auto size = juce::ByteOrder::littleEndianInt(record + fieldOffset + 4);
+    if (!fitsWithin(offset, size, stringsSize) || size > static_cast<juce::uint32>(std::numeric_limits<int>::max()))
+        return {};
+
+    return juce::String::fromUTF8(reinterpret_cast<const char*>(data + stringsOffset + offset), static_cast<int>(size));
+}
+
+juce::String PatternPack::getName(int index) const
+{
+    return getString(index, kNameField);
+}
+
+juce::String PatternPack::getType(int index) const
+{
+    return getString(index, kTypeField);
+}
+
+juce::String PatternPack::getStyle(int index) const
+{
+    return getString(index, kStyleField);
+}
+
+juce::Time PatternPack::getModified(int index) const
+{
+    const auto* record = getRecord(index);
+    if (record == nullptr)
+        return {};
+
+    return juce::Time(static_cast<juce::int64>(juce::ByteOrder::littleEndianInt64(record + kModifiedField)));
+}
+
+juce::uint64 PatternPack::getContentHash(int index) const
+{
+    const auto* record = getRecord(index);
+    return record != nullptr ? juce::ByteOrder::littleEndianInt64(record + kContentHashField) : 0;
+}
+
+bool PatternPack::getPayload(int index, const juce::uint8*& payload, size_t& payloadSize) const noexcept
+{
+    const auto* record = getRecord(index);
+    if (record == nullptr)
+        return false;
+
+    const auto offset = juce::ByteOrder::littleEndianInt64(record + kPayloadOffsetField);
+    const auto size = juce::ByteOrder::littleEndianInt64(record + kPayloadSizeField);
+    if (!fitsWithin(offset, size, dataSize))
+        return false;
+
+    payload = data + offset;
+    payloadSize = static_cast<size_t>(size);
+    return true;
+}
+
+bool PatternPack::readEntry(int index, PatternEntry& result, ValidationReport& report) const
+{
+    report = {};
+    const juce::uint8* payload = nullptr;
+    size_t payloadSize = 0;
+    if (!getPayload(index, payload, payloadSize))
+    {
+        report.error = ValidationError::Truncated;
+        return false;
+    }
+
+    if (hashPayload(payload, payloadSize) != getContentHash(index))
+    {
+        report.error = ValidationError::ChecksumMismatch;
+        return false;
+    }
+
+    PatternEntry entry;
+    if (!Pattern::tryFromBinary(payload, payloadSize, entry.pattern, report))
+        return false;
+
+    entry.name = getName(index);
+    entry.type = getType(index);
+    entry.style = getStyle(index);
+    entry.modified = getModified(index);
+
+    if (!entry.validate())
+    {
+        report.error = ValidationError::InvalidMetadata;
+        return false;
+    }
+
+    result = std::move(entry);
+    return true;
+}
+
+void PatternPack::Builder::add(const PatternEntry& entry)
+{
+    auto& block = encodedPayloads.emplace_back();
+    {
+        juce::MemoryOutputStream out(block, false);
+        entry.pattern.writeBinary(out);
+    }
+
+    Record record;
+    record.name = entry.name;
+    record.type = entry.type;
+    record.style = entry.style;
+    record.modified = entry.modified.toMilliseconds();
+    record.contentHash = hashPayload(block.getData(), block.getSize());
+    record.payload = block.getData();
+    record.payloadSize = block.getSize();
+    records.push_back(std::move(record));
+}
+
+bool PatternPack::Builder::add(const PatternPack& pack, int index)
+{
+    const juce::uint8* payload = nullptr;
+    size_t payloadSize = 0;
+    if (!pack.getPayload(index, payload, payloadSize))
+        return false;
+
+    Record record;
+    record.name = pack.getName(index);
+    record.type = pack.getType(index);
+    record.style = pack.getStyle(index);
+    record.modified = pack.getModified(index).toMilliseconds();
+    record.contentHash = pack.getContentHash(index);
+    record.payload = payload;
+    record.payloadSize = payloadSize;
+    records.push_back(std::move(record));
+    return true;
+}
+
+bool PatternPack::Builder::write(juce::OutputStream& out) const
+{
+    if (records.size() > std::numeric_limits<juce::uint32>::max())
+        return false;
+
+    // Lay out the strings, storing each distinct one once; types and styles repeat a lot
+    juce::MemoryOutputStream strings;
+    std::map<juce::String, StringRef> stringRefs;
+    std::vector<std::array<StringRef, 3>> recordStrings;
+    recordStrings.reserve(records.size());
+
+    const auto addString = [&](const juce::String& text, StringRef& ref) {
+        const auto existing = stringRefs.find(text);
+        if (existing != stringRefs.end())
+        {
+            ref = existing->second;
+            return true;
+        }
+
+        const auto utf8 = text.toUTF8();
+        const auto numBytes = utf8.sizeInBytes() - 1;
+        if (numBytes > std::numeric_limits<juce::uint32>::max() - strings.getDataSize())
+            return false;
+
+        ref.offset = static_cast<juce::uint32>(strings.getDataSize());
+        ref.size = static_cast<juce::uint32>(numBytes);
+        strings.write(utf8.getAddress(), numBytes);
+        stringRefs.emplace(text, ref);
+        return true;
+    };
+
+    for (const auto& record : records)
+    {
+        std::array<StringRef, 3> refs;
+        if (!addString(record.name, refs[0]) || !addString(record.type, refs[1]) || !addString(record.style, refs[2]))
+            return false;
+        recordStrings.push_back(refs);
+    }
+
+    // Lay out the payloads, sharing storage between identical ones
+    struct Payload {
+        const void* data;
+        size_t size;
+        size_t offset;
+    };
+    std::vector<Payload> payloads;
+    std::unordered_map<juce::uint64, std::vector<size_t>> payloadsByHash;
+    std::vector<size_t> recordPayloads;
+    recordPayloads.reserve(records.size());
+
+    const auto stringsOffset = kHeaderSize + records.size() * kIndexRecordSize;
+    auto nextOffset = alignUp(stringsOffset + strings.getDataSize());
+
+    for (const auto& record : records)
+    {
+        auto& candidates = payloadsByHash[record.contentHash];
+        const auto match = std::find_if(candidates.begin(), candidates.end(), [&](size_t candidate) {
+            const auto& payload = payloads[candidate];
+            return payload.size == record.payloadSize
+                   && std::memcmp(payload.data, record.payload, record.payloadSize) == 0;
+        });
+
+        if (match != candidates.end())
+        {
+            recordPayloads.push_back(*match);
+            continue;
+        }
+
+        candidates.push_back(payloads.size());
+        recordPayloads.push_back(payloads.size());
+        payloads.push_back({ record.payload, record.payloadSize, nextOffset });
+        nextOffset = alignUp(nextOffset + record.payloadSize);
+    }
+
+    out.write(kMagic, sizeof(kMagic));
+    out.writeShort(static_cast<short>(kVersion));
+    out.writeShort(static_cast<short>(kHeaderSize));
+    out.writeInt(static_cast<int>(records.size()));
+    out.writeInt(static_cast<int>(kIndexRecordSize));
+    out.writeInt64(static_cast<juce::int64>(stringsOffset));
+    out.writeInt64(static_cast<juce::int64>(strings.getDataSize()));
+
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        const auto& record = records[i];
+        const auto& payload = payloads[recordPayloads[i]];
+        out.writeInt64(static_cast<juce::int64>(payload.offset));
+        out.writeInt64(static_cast<juce::int64>(payload.size));
+        out.writeInt64(record.modified);
+        out.writeInt64(static_cast<juce::int64>(record.contentHash));
+        for (const auto& ref : recordStrings[i])
+        {
+            out.writeInt(static_cast<int>(ref.offset));
+            out.writeInt(static_cast<int>(ref.size));
+        }
+    }
+
+    out.write(strings.getData(), strings.getDataSize());
+
+    auto position = stringsOffset + strings.getDataSize();
+    for (const auto& payload : payloads)
+    {
+        out.writeRepeatedByte(0, payload.offset - position);
+        out.write(payload.data, payload.size);
+        position = payload.offset + payload.size;
+    }
+
+    return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Models/PatternEntry.h"
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Read-only library of pattern entries in a single indexed file
+ *
+ * A pack is memory-mapped when opened, and opening only checks the header,
+ * so its cost does not depend on the number of entries. An entry's metadata
+ * is read from the index when asked for, and its pattern is decoded only by
+ * readEntry(). Every value is little-endian.
+ *
+ *   Header, 32 bytes
+ *     0   char[4]  magic "GSPK"
+ *     4   uint16   version
+ *     6   uint16   headerSize
+ *     8   uint32   entryCount
+ *     12  uint32   indexRecordSize
+ *     16  uint64   stringsOffset
+ *     24  uint64   stringsSize
+ *
+ *   Index record, 56 bytes, entryCount of them after the header
+ *     0   uint64   payloadOffset
+ *     8   uint64   payloadSize
+ *     16  int64    modified (milliseconds)
+ *     24  uint64   contentHash, 64-bit FNV-1a of the payload
+ *     32  uint32   name offset and size, into the strings section
+ *     40  uint32   type offset and size
+ *     48  uint32   style offset and size
+ *
+ * The strings section holds UTF-8 text without terminators. Each payload is
+ * a binary pattern as described in PatternFormat.h, starting on an 8-byte
+ * boundary so its records can be decoded in place; entries with identical
+ * payloads share one copy.
+ *
+ * Not thread-safe beyond concurrent reads of an unchanging pack.
+ */
+class PatternPack {
+public:
+    static constexpr char kMagic[4] = { 'G', 'S', 'P', 'K' };
+    static constexpr juce::uint16 kVersion = 1;
+    static constexpr size_t kHeaderSize = 32;
+    static constexpr size_t kIndexRecordSize = 56;
+    static constexpr const char* kFileExtension = ".gspk";
+
+    /**
+     * @brief Maps a pack file and checks its header and index bounds
+     * @param report Receives NotPatternPack, UnsupportedVersion, CorruptHeader or Truncated
+     * @return The pack, or nullptr if the file could not be read or is not a valid pack
+     */
+    static std::unique_ptr<PatternPack> tryOpen(const juce::File& file, ValidationReport& report);
+
+    [[nodiscard]] int size() const noexcept { return static_cast<int>(entryCount); }
+    [[nodiscard]] const juce::File& getFile() const noexcept { return file; }
+
+    // Metadata straight from the index; a damaged string reads as empty
+    [[nodiscard]] juce::String getName(int index) const;
+    [[nodiscard]] juce::String getType(int index) const;
+    [[nodiscard]] juce::String getStyle(int index) const;
+    [[nodiscard]] juce::Time getModified(int index) const;
+    [[nodiscard]] juce::uint64 getContentHash(int index) const;
+
+    /**
+     * @brief Decodes one entry, checking its payload against the stored hash
+     * @param report Receives ChecksumMismatch, Truncated, InvalidMetadata or the pattern's problems
+     * @return False, leaving result untouched, if the entry is damaged or fails validate()
+     */
+    bool readEntry(int index, PatternEntry& result, ValidationReport& report) const;
+
+    /**
+     * @brief Collects entries and writes them out as a pack
+     *
+     * Entries copied from an open pack keep their encoded payload and hash,
+     * so rewriting a pack never decodes its patterns; that pack must stay
+     * open until write() returns.
+     */
+    class Builder {
+    public:
+        // Encodes the entry's pattern now; the entry should pass validate()
+        void add(const PatternEntry& entry);
+
+        // False if the index is out of range or its payload lies outside the pack
+        bool add(const PatternPack& pack, int index);
+
+        [[nodiscard]] int size() const noexcept { return static_cast<int>(records.size()); }
+
+        // False if the strings section would not fit the format's 32-bit offsets
+        bool write(juce::OutputStream& out) const;
+
+    private:
+        struct Record {
+            juce::String name;
+            juce::String type;
+            juce::String style;
+            juce::int64 modified{0};
+            juce::uint64 contentHash{0};
+            const void* payload{nullptr};
+            size_t payloadSize{0};
+        };
+
+        std::vector<Record> records;
+        std::deque<juce::MemoryBlock> encodedPayloads;   // A deque keeps the blocks in place as it grows
+    };
+
+private:
+    PatternPack() = default;
+
+    [[nodiscard]] const juce::uint8* getRecord(int index) const noexcept;
+    [[nodiscard]] juce::String getString(int index, size_t fieldOffset) const;
+
+    // True and sets payload if the entry's payload lies inside the file
+    bool getPayload(int index, const juce::uint8*& payload, size_t& payloadSize) const noexcept;
+
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    juce::MemoryBlock loadedData;   // Used only when the file can't be mapped
+    const juce::uint8* data{nullptr};
+    size_t dataSize{0};
+
+    size_t entryCount{0};
+    size_t indexOffset{0};
+    size_t indexRecordSize{kIndexRecordSize};
+    size_t stringsOffset{0};
+    size_t stringsSize{0};
+
+    JUCE_DECLARE_NON_COPYABLE(PatternPack)
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Pattern.h"
+#include "Common.h"
+#include "TimingPlan.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <utility>
+
+/**
+ * @brief A single playback step, packed from the authoring Note into 8 bytes
+ *
+ * Velocity is kept in 8.8 fixed point, which covers the Note range of 0-127
+ * to within 1/256; pitch and the flags take a byte each. With the marker
+ * event a full pattern's steps are just over 1 KB, so the steps and positions
+ * the scheduler walks stay within a 32 KB L1 data cache for all tracks.
+ */
+struct CompiledStep {
+    static constexpr juce::uint8 kActiveFlag = 1 << 0;
+    static constexpr juce::uint8 kStaccatoFlag = 1 << 1;
+    static constexpr juce::uint8 kRestFlag = 1 << 2;
+    static constexpr int kAccentShift = 3;           // Two bits of accent level
+    static constexpr float kVelocityScale = 256.0f;
+
+    float duration{1.0f};           // Beats
+    juce::uint16 velocity{0};       // 8.8 fixed point
+    juce::uint8 pitch{60};
+    juce::uint8 flags{0};
+
+    void packFrom(const Note& note) noexcept {
+        duration = note.duration;
+        velocity = static_cast<juce::uint16>(juce::roundToInt(
+            juce::jlimit(0.0f, PatternConstants::MAX_VELOCITY, note.velocity) * kVelocityScale));
+        pitch = static_cast<juce::uint8>(juce::jlimit(PatternConstants::MIN_MIDI_NOTE, PatternConstants::MAX_MIDI_NOTE, note.pitch));
+
+        const int accent = juce::jlimit(PatternConstants::MIN_ACCENT, PatternConstants::MAX_ACCENT, note.accent);
+        flags = static_cast<juce::uint8>((note.active ? kActiveFlag : 0)
+                                         | (note.isStaccato ? kStaccatoFlag : 0)
+                                         | (note.isRest ? kRestFlag : 0)
+                                         | (accent << kAccentShift));
+    }
+
+    [[nodiscard]] float getVelocity() const noexcept { return static_cast<float>(velocity) / kVelocityScale; }
+    [[nodiscard]] int getAccent() const noexcept { return (flags >> kAccentShift) & 0x3; }
+    [[nodiscard]] bool isActive() const noexcept { return (flags & kActiveFlag) != 0; }
+    [[nodiscard]] bool isStaccato() const noexcept { return (flags & kStaccatoFlag) != 0; }
+    [[nodiscard]] bool isRest() const noexcept { return (flags & kRestFlag) != 0; }
+};
+static_assert(sizeof(CompiledStep) == 8, "Compiled steps are meant to pack into 8 bytes");
+static_assert(PatternConstants::MAX_VELOCITY * CompiledStep::kVelocityScale <= 65535.0f,
+              "Fixed-point velocity must fit in 16 bits");
+
+/**
+ * @brief Immutable, fixed-capacity event timeline of a Pattern read by the audio thread
+ *
+ * Notes are sorted by start time into parallel arrays, so playback honours
+ * arbitrary start times and chords, and finding the first event at or after
+ * a position is a binary search. Positions are in fixed-point steps; a note
+ * starting at beat b sits at step b * kStepsPerBeat of its track, whatever
+ * the track's division. The timeline loops every loopLength units, a whole
+ * number of steps covering every note's end.
+ *
+ * Sized for the longest legal pattern so compiling never allocates.
+ */
+struct CompiledPattern {
+    static constexpr int kMaxNotes = PatternConstants::MAX_NOTES;
+    static constexpr int kMaxEvents = kMaxNotes + 1;          // Plus a loop-start marker
+    static constexpr juce::int64 kUnitsPerStep = 960;
+    static constexpr int kStepsPerBeat = TimingPlan::kTicksPerBeat;
+    static constexpr juce::int64 kMaxPosition = juce::int64{1} << 30;
+
+    std::array<juce::int32, kMaxEvents> positions{};         // Sorted, in units from the loop start
+    std::array<CompiledStep, kMaxEvents> steps{};            // In position order
+    std::array<juce::int16, kMaxEvents> noteIndices{};       // Authoring note index, or -1 for the marker
+    int numEvents{0};
+    int numSteps{0};                                         // Authoring notes compiled
+    juce::int64 loopLength{0};
+
+    /**
+     * @brief Compiles the earliest kMaxNotes notes of a pattern
+     * @return How many later notes did not fit; Pattern::check() rejects such patterns
+     */
+    int compileFrom(const Pattern& pattern) noexcept {
+        const auto& notes = pattern.getNotes();
+        numSteps = 0;
+        numEvents = 0;
+        loopLength = 0;
+
+        // Keep the earliest notes in a bounded max-heap of (position, note index), so an
+        // oversized pattern loses its latest notes rather than whichever were authored
+        // last. Ties keep authoring order, so a chord's notes go out as they were written
+        std::array<std::pair<juce::int32, juce::int32>, kMaxNotes> earliest{};
+        for (size_t i = 0; i < notes.size(); ++i) {
+            const std::pair<juce::int32, juce::int32> key{ static_cast<juce::int32>(toPosition(notes[i].startTime)),
+                                                          static_cast<juce::int32>(i) };
+            if (numSteps < kMaxNotes) {
+                earliest[static_cast<size_t>(numSteps++)] = key;
+                std::push_heap(earliest.begin(), earliest.begin() + numSteps);
+            } else if (key < earliest[0]) {
+                std::pop_heap(earliest.begin(), earliest.begin() + numSteps);
+                earliest[static_cast<size_t>(numSteps - 1)] = key;
+                std::push_heap(earliest.begin(), earliest.begin() + numSteps);
+            }
+        }
+        if (numSteps == 0)
+            return 0;
+
+        std::sort_heap(earliest.begin(), earliest.begin() + numSteps);
+
+        // The loop start always has an event, so the loop point is clocked even after a rest
+        if (earliest[0].first > 0) {
+            positions[0] = 0;
+            steps[0] = CompiledStep{};
+            noteIndices[0] = -1;
+            numEvents = 1;
+        }
+
+        juce::int64 end = kUnitsPerStep;
+        for (int i = 0; i < numSteps; ++i) {
+            const auto [position, noteIndex] = earliest[static_cast<size_t>(i)];
+            const auto& note = notes[static_cast<size_t>(noteIndex)];
+            const auto e = static_cast<size_t>(numEvents++);
+            positions[e] = position;
+            steps[e].packFrom(note);
+            noteIndices[e] = static_cast<juce::int16>(noteIndex);
+            end = std::max(end, toPosition(note.startTime + std::max(0.0f, note.duration)));
+        }
+
+        loopLength = (end + kUnitsPerStep - 1) / kUnitsPerStep * kUnitsPerStep;
+        return static_cast<int>(notes.size()) - numSteps;
+    }
+
+    [[nodiscard]] bool isEmpty() const noexcept { return numEvents == 0; }
+
+    // Events are numbered across loops: event n is index n mod numEvents of loop floor(n / numEvents)
+    [[nodiscard]] juce::int64 getLoop(juce::int64 event) const noexcept {
+        return MathUtils::floorDivide(event, numEvents);
+    }
+
+    [[nodiscard]] int getIndex(juce::int64 event) const noexcept {
+        return static_cast<int>(event - getLoop(event) * numEvents);
+    }
+
+    [[nodiscard]] juce::int64 getPosition(juce::int64 event) const noexcept {
+        return getLoop(event) * loopLength + positions[static_cast<size_t>(getIndex(event))];
+    }
+
+    // First event at or after an absolute position
+    [[nodiscard]] juce::int64 findEvent(juce::int64 position) const noexcept {
+        const auto loop = MathUtils::floorDivide(position, loopLength);
+        const auto offset = position - loop * loopLength;
+        const auto* first = positions.data();
+        const auto index = std::lower_bound(first, first + numEvents, offset) - first;
+        return loop * numEvents + index;
+    }
+
+private:
+    static juce::int64 toPosition(float beats) noexcept {
+        const double units = static_cast<double>(beats) * kStepsPerBeat * kUnitsPerStep;
+        if (!(units > 0.0))
+            return 0;
+        return static_cast<juce::int64>(juce::jlimit(0.0, static_cast<double>(kMaxPosition), std::round(units)));
+    }
+};
+
+/**
+ * @brief Every track's steps plus per-track lanes, as read by the audio thread
+ *
+ * Track settings are flattened into arrays indexed by track, and the tracks
+ * the scheduler has to visit are kept as bitmasks, so a block only touches
+ * tracks that can produce events.
+ */
+struct CompiledTracks {
+    static constexpr int kNumTracks = TrackConstants::NUM_TRACKS;
+    static_assert(kNumTracks <= 32, "Track masks are 32 bits wide");
+
+    std::array<CompiledPattern, kNumTracks> patterns{};
+    std::array<int, kNumTracks> ticksPerStep{};
+    std::array<int, kNumTracks> midiChannels{};
+
+    juce::uint32 audibleMask{0};   // Non-empty tracks left sounding by mute and solo
+    juce::uint32 clockedMask{0};   // Audible tracks plus the main track, which drives the loop point
+
+    void compileSettings(const std::array<TrackSettings, kNumTracks>& settings) noexcept {
+        bool anySoloed = false;
+        for (const auto& track : settings)
+            anySoloed = anySoloed || track.soloed;
+
+        audibleMask = 0;
+        for (int t = 0; t < kNumTracks; ++t) {
+            const auto& track = settings[static_cast<size_t>(t)];
+            ticksPerStep[static_cast<size_t>(t)] = TimingPlan::getTicksPerStep(track.division);
+            midiChannels[static_cast<size_t>(t)] = juce::jlimit(1, 16, track.midiChannel);
+
+            const bool audible = !track.muted && (!anySoloed || track.soloed);
+            if (audible && !patterns[static_cast<size_t>(t)].isEmpty())
+                audibleMask |= juce::uint32{1} << t;
+        }
+
+        clockedMask = audibleMask;
+        if (!patterns[TrackConstants::MAIN_TRACK].isEmpty())
+            clockedMask |= juce::uint32{1} << TrackConstants::MAIN_TRACK;
+    }
+
+    [[nodiscard]] const CompiledPattern& getMainPattern() const noexcept {
+        return patterns[TrackConstants::MAIN_TRACK];
+    }
+};
+static_assert(CompiledTracks::kNumTracks * (sizeof(CompiledPattern::steps) + sizeof(CompiledPattern::positions))
+                  <= 32 * 1024,
+              "Every track's steps and positions are meant to fit in a 32 KB L1 data cache");
+
+/**
+ * @brief Triple-buffered handoff of compiled tracks to the audio thread
+ *
+ * The writer compiles into the back slot and publishes it with one atomic
+ * exchange; the reader picks up the most recent publication the same way.
+ * Neither side blocks or allocates. Writers must be serialised by the caller.
+ *
+ * A publication may be marked to wait for a loop boundary; the reader then
+ * leaves it pending until it asks for deferred publications too. The mark
+ * sticks until the reader takes it, even if newer publications replace it.
+ */
+class PatternSnapshotBuffer {
+public:
+    PatternSnapshotBuffer() = default;
+
+    /**
+     * @brief Compiles into the back slot and publishes it (writer side)
+     * @param compile Called with the slot to fill; it holds stale data from an earlier publication
+     */
+    template <typename CompileFunction>
+    void publish(CompileFunction&& compile, bool applyAtLoopBoundary = false) noexcept {
+        compile(slots[static_cast<size_t>(backIndex)]);
+
+        int expected = middle.load(std::memory_order_relaxed);
+        int desired;
+        do {
+            const bool stillDeferred = (expected & kDirtyFlag) != 0 && (expected & kDeferredFlag) != 0;
+            desired = backIndex | kDirtyFlag | (applyAtLoopBoundary || stillDeferred ? kDeferredFlag : 0);
+        } while (!middle.compare_exchange_weak(expected, desired, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        backIndex = expected & kIndexMask;
+    }
+
+    /**
+     * @brief Makes the most recent publication live (audio thread)
+     * @param atLoopBoundary Also take publications marked to wait for a loop boundary
+     */
+    bool acquireLatest(bool atLoopBoundary = true) noexcept {
+        int expected = middle.load(std::memory_order_relaxed);
+        do {
+            if ((expected & kDirtyFlag) == 0)
+                return false;
+            if ((expected & kDeferredFlag) != 0 && !atLoopBoundary)
+                return false;
+        } while (!middle.compare_exchange_weak(expected, frontIndex, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        frontIndex = expected & kIndexMask;
+        return true;
+    }
+
+    [[nodiscard]] const CompiledTracks& getLive() const noexcept {
+        return slots[static_cast<size_t>(frontIndex)];
+    }
+
+private:
+    static constexpr int kIndexMask = 0x3;
+    static constexpr int kDirtyFlag = 0x4;
+    static constexpr int kDeferredFlag = 0x8;
+
+    std::array<CompiledTracks, 3> slots;
+    std::atomic<int> middle{1};
+    int frontIndex{0};
+    int backIndex{2};
+
+    JUCE_DECLARE_NON_COPYABLE(PatternSnapshotBuffer)
+};
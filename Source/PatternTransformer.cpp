@@ -2,6 +2,7 @@
 #include <JuceHeader.h>
 #include <ctime>
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <chrono>
@@ -105,11 +106,22 @@ namespace PTLogger {
     }
 }
 
+namespace {
+    // Whole beats needed to hold every note, never less than minimumLength
+    int getLengthToFit(const std::vector<Note>& notes, int minimumLength) {
+        double end = 0.0;
+        for (const auto& note : notes) {
+            end = std::max(end, static_cast<double>(note.startTime) + static_cast<double>(note.duration));
+        }
+        const auto beats = static_cast<int>(std::ceil(end));
+        return juce::jlimit(PatternConstants::MIN_LENGTH, PatternConstants::MAX_LENGTH, std::max(minimumLength, beats));
+    }
+}
+
 PatternTransformer::PatternTransformer()
     : currentRhythm(RhythmPattern::Regular)
     , currentArticulation(ArticulationStyle::Legato)
     , currentGridSize(0.25) // Default to 16th notes
-    , transformationType(TransformationType::StepUp)
     , rng(std::time(nullptr))
 {
     // Initialize default scale (C major)
@@ -128,14 +140,17 @@ Pattern PatternTransformer::generatePattern(TransformationType type, int length)
 {
     Pattern result;
     result.setLength(length);
-    result.getNotes() = generateNotes(length);
+    result.setNotes(generatePattern(length));
     return result;
 }
 
 Pattern PatternTransformer::transformPattern(const Pattern& source, TransformationType type)
 {
-    Pattern result;
-    result.getNotes() = applyTransformation(source.getNotes(), type);
+    // Keeps the source's tempo and grid; transformations that append notes
+    // (StepUp, Mirror, ...) lengthen the pattern so it still holds them all
+    auto notes = applyTransformation(source.getNotes(), type);
+    Pattern result(getLengthToFit(notes, source.getLength()), source.getTempo(), source.getGridSize());
+    result.setNotes(std::move(notes));
     return result;
 }
 
@@ -442,7 +457,7 @@ void PatternTransformer::setGridSize(double size) {
 Pattern PatternTransformer::generatePatternWithRhythm(const std::vector<Note>& input, RhythmPattern pattern)
 {
     Pattern result;
-    result.getNotes() = applyRhythmPattern(input, pattern);
+    result.setNotes(applyRhythmPattern(input, pattern));
     return result;
 }
 
@@ -822,7 +837,7 @@ std::vector<Note> PatternTransformer::generatePattern(int targetLength)
         Note note;
         note.pitch = currentScale.root;
         note.startTime = 0.0f;
-        note.duration = 1.0f;
+        note.duration = static_cast<float>(currentGridSize);   // One step apart, so note i plays on step i
         result.push_back(note);
     }
     
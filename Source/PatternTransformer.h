@@ -120,7 +120,7 @@ public:
     void setSeedNotes(const std::vector<Note>& seeds);
     [[nodiscard]] Pattern generatePattern(TransformationType type, int length);
     [[nodiscard]] Pattern transformPattern(const Pattern& source, TransformationType type);
-    [[nodiscard]] std::vector<Note> previewTransformation(TransformationType type, int previewLength);
+    [[nodiscard]] std::vector<Note> previewTransformation(const Pattern& pattern, TransformationType type);
     [[nodiscard]] std::vector<Note> generatePattern(int targetLength);
     [[nodiscard]] std::vector<Note> applyTransformation(const std::vector<Note>& input, TransformationType type);
     
@@ -139,19 +139,10 @@ public:
     [[nodiscard]] const RandomParameters& getRandomParameters() const { return randomParams; }
     
     // Combined pattern generation
-    [[nodiscard]] Pattern generatePatternWithRhythm(
-        TransformationType type, 
-        RhythmPattern rhythm, 
-        ArticulationStyle articulation, 
-        int length);
-    
-    // Pattern application methods
-    [[nodiscard]] Pattern applyRhythmAndArticulation(
-        const Pattern& source, 
-        TransformationType type,
-        RhythmPattern rhythm, 
-        ArticulationStyle style, 
-        int length);
+    [[nodiscard]] Pattern generatePatternWithRhythm(const std::vector<Note>& input, RhythmPattern pattern);
+    
+    // Applies the current rhythm and articulation style in place
+    void applyRhythmAndArticulation(Pattern& pattern);
 
     /**
      * @brief Applies rhythm steps to a sequence of notes
@@ -4,6 +4,23 @@
 #include "Components/GridSequencerComponent.h"
 #include "GrooveSequencerLookAndFeel.h"
 
+namespace {
+    // Division selector items are 1/4, 1/8 and 1/16
+    NoteDivision divisionFromItemId(int itemId)
+    {
+        if (itemId == 1) return NoteDivision::Quarter;
+        if (itemId == 2) return NoteDivision::Eighth;
+        return NoteDivision::Sixteenth;
+    }
+    
+    int itemIdFromDivision(NoteDivision division)
+    {
+        if (division == NoteDivision::Quarter) return 1;
+        if (division == NoteDivision::Eighth) return 2;
+        return 3;
+    }
+}
+
 //==============================================================================
 GrooveSequencerAudioProcessorEditor::GrooveSequencerAudioProcessorEditor(GrooveSequencerAudioProcessor& p)
     : AudioProcessorEditor(&p), processor(p)
@@ -19,6 +36,7 @@ GrooveSequencerAudioProcessorEditor::GrooveSequencerAudioProcessorEditor(GrooveS
     // Set up all UI components
     setupTransportControls();
     setupGridControls();
+    setupTrackControls();
     setupArticulationControls();
     setupPatternControls();
     setupFileControls();
@@ -35,16 +53,25 @@ GrooveSequencerAudioProcessorEditor::GrooveSequencerAudioProcessorEditor(GrooveS
         state, Parameters::GATE_ID, gateLengthSlider);
     lengthAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
         state, Parameters::LENGTH_ID, lengthSlider);
+    trackAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        state, Parameters::TRACK_ID, trackSelector);
+    showTrack(processor.getSelectedTrack());
     
     // Set window size
     setSize(800, 600);
     
+    // Save and load run in the background; failures come back on the message thread
+    processor.onPatternFileError = [this](const juce::String& message) {
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Pattern File", message);
+    };
+    
     // Start timer for UI updates
     startTimerHz(30);
 }
 
 GrooveSequencerAudioProcessorEditor::~GrooveSequencerAudioProcessorEditor()
 {
+    processor.onPatternFileError = nullptr;
     setLookAndFeel(nullptr);
 }
 
@@ -60,8 +87,9 @@ void GrooveSequencerAudioProcessorEditor::resized()
     // Top section: Transport and tempo controls
     auto topSection = area.removeFromTop(80);
     auto transportSection = topSection.removeFromLeft(200);
-    playStopButton.setBounds(transportSection.removeFromLeft(95));
-    loopButton.setBounds(transportSection);
+    playStopButton.setBounds(transportSection.removeFromLeft(65));
+    loopButton.setBounds(transportSection.removeFromLeft(65));
+    syncButton.setBounds(transportSection);
     
     auto tempoSection = topSection.removeFromLeft(200);
     tempoLabel.setBounds(tempoSection.removeFromTop(20));
@@ -75,18 +103,28 @@ void GrooveSequencerAudioProcessorEditor::resized()
     
     // Grid controls section
     auto gridControlsSection = area.removeFromTop(80);
-    auto gridSizeSection = gridControlsSection.removeFromLeft(150);
+    auto gridSizeSection = gridControlsSection.removeFromLeft(110);
     gridSizeLabel.setBounds(gridSizeSection.removeFromTop(20));
     gridSizeSelector.setBounds(gridSizeSection);
     
-    auto divisionSection = gridControlsSection.removeFromLeft(150);
+    auto divisionSection = gridControlsSection.removeFromLeft(110);
     divisionLabel.setBounds(divisionSection.removeFromTop(20));
     divisionSelector.setBounds(divisionSection);
     
-    auto lengthSection = gridControlsSection;
+    auto lengthSection = gridControlsSection.removeFromLeft(200);
     lengthLabel.setBounds(lengthSection.removeFromTop(20));
     lengthSlider.setBounds(lengthSection);
     
+    gridControlsSection.removeFromLeft(10); // Spacing
+    
+    auto trackSection = gridControlsSection;
+    trackLabel.setBounds(trackSection.removeFromTop(20));
+    auto trackRow = trackSection.removeFromTop(30);
+    trackSelector.setBounds(trackRow.removeFromLeft(100));
+    channelSelector.setBounds(trackRow.removeFromLeft(80));
+    trackEnabledButton.setBounds(trackRow);
+    copyToTrackButton.setBounds(trackSection.removeFromTop(30));
+    
     area.removeFromTop(10); // Spacing
     
     // Main grid area
@@ -140,6 +178,10 @@ void GrooveSequencerAudioProcessorEditor::resized()
     saveButton.setBounds(fileButtons.removeFromLeft(145));
     loadButton.setBounds(fileButtons);
     
+    auto historyButtons = fileSection.removeFromTop(30);
+    undoButton.setBounds(historyButtons.removeFromLeft(145));
+    redoButton.setBounds(historyButtons);
+    
     fileSection.removeFromTop(10);
     midiInputLabel.setBounds(fileSection.removeFromTop(20));
     midiMonitor.setBounds(fileSection);
@@ -168,6 +210,16 @@ void GrooveSequencerAudioProcessorEditor::setupTransportControls()
         processor.setLoopMode(loopButton.getToggleState());
     };
     
+    // Host sync button
+    addAndMakeVisible(syncButton);
+    syncButton.setButtonText("Sync");
+    syncButton.setClickingTogglesState(true);
+    syncButton.setToggleState(processor.getTransportSource() == TransportSource::Host, juce::dontSendNotification);
+    syncButton.onClick = [this]() {
+        processor.setTransportSource(syncButton.getToggleState() ? TransportSource::Host
+                                                                 : TransportSource::Internal);
+    };
+    
     // Tempo control
     addAndMakeVisible(tempoSlider);
     addAndMakeVisible(tempoLabel);
@@ -206,11 +258,7 @@ void GrooveSequencerAudioProcessorEditor::setupGridControls()
     divisionSelector.addItemList({"1/4", "1/8", "1/16"}, 1);
     divisionSelector.setSelectedId(3, juce::dontSendNotification); // Default to 1/16
     divisionSelector.onChange = [this]() {
-        const int selectedId = divisionSelector.getSelectedId();
-        NoteDivision division = NoteDivision::Sixteenth;
-        if (selectedId == 1) division = NoteDivision::Quarter;
-        else if (selectedId == 2) division = NoteDivision::Eighth;
-        processor.setNoteDivision(division);
+        processor.setTrackDivision(processor.getSelectedTrack(), divisionFromItemId(divisionSelector.getSelectedId()));
     };
     
     // Length control
@@ -223,6 +271,50 @@ void GrooveSequencerAudioProcessorEditor::setupGridControls()
     lengthSlider.setRange(1, 64, 1);
 }
 
+void GrooveSequencerAudioProcessorEditor::setupTrackControls()
+{
+    // The selector is attached to the Track parameter; the other controls follow it
+    addAndMakeVisible(trackLabel);
+    trackLabel.setText("Track", juce::dontSendNotification);
+    trackLabel.setJustificationType(juce::Justification::centred);
+    
+    addAndMakeVisible(trackSelector);
+    for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+        trackSelector.addItem("Track " + juce::String(track + 1), track + 1);
+    
+    addAndMakeVisible(channelSelector);
+    for (int channel = 1; channel <= 16; ++channel)
+        channelSelector.addItem("Ch " + juce::String(channel), channel);
+    channelSelector.onChange = [this]() {
+        processor.setTrackMidiChannel(processor.getSelectedTrack(), channelSelector.getSelectedId());
+    };
+    
+    addAndMakeVisible(trackEnabledButton);
+    trackEnabledButton.setButtonText("Enabled");
+    
+    // Other tracks are filled from the grid, which always edits the main track
+    addAndMakeVisible(copyToTrackButton);
+    copyToTrackButton.setButtonText("Copy Grid to Track");
+    copyToTrackButton.onClick = [this]() {
+        processor.setTrackPattern(processor.getSelectedTrack(), processor.getPattern());
+    };
+}
+
+void GrooveSequencerAudioProcessorEditor::showTrack(int track)
+{
+    shownTrack = track;
+    
+    // Re-attach the Enabled button to the selected track's parameter
+    trackEnabledAttachment.reset();
+    trackEnabledAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processor.getState(), Parameters::getTrackEnabledId(track), trackEnabledButton);
+    
+    const auto settings = processor.getTrackSettings(track);
+    divisionSelector.setSelectedId(itemIdFromDivision(settings.division), juce::dontSendNotification);
+    channelSelector.setSelectedId(settings.midiChannel, juce::dontSendNotification);
+    copyToTrackButton.setEnabled(track != TrackConstants::MAIN_TRACK);
+}
+
 void GrooveSequencerAudioProcessorEditor::setupArticulationControls()
 {
     // Velocity control
@@ -299,6 +391,19 @@ void GrooveSequencerAudioProcessorEditor::setupPatternControls()
     transformButton.onClick = [this]() {
         processor.transformCurrentPattern();
     };
+    
+    // Pattern history; enabled state is refreshed by the timer
+    addAndMakeVisible(undoButton);
+    undoButton.setButtonText("Undo");
+    undoButton.onClick = [this]() {
+        processor.undoPatternEdit();
+    };
+    
+    addAndMakeVisible(redoButton);
+    redoButton.setButtonText("Redo");
+    redoButton.onClick = [this]() {
+        processor.redoPatternEdit();
+    };
 }
 
 void GrooveSequencerAudioProcessorEditor::setupFileControls()
@@ -307,10 +412,10 @@ void GrooveSequencerAudioProcessorEditor::setupFileControls()
     addAndMakeVisible(saveButton);
     saveButton.setButtonText("Save Pattern");
     saveButton.onClick = [this]() {
-        auto fileChooser = std::make_unique<juce::FileChooser>(
+        fileChooser = std::make_unique<juce::FileChooser>(
             "Save Pattern",
             juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
-            "*.xml");
+            "*.gsp;*.pattern");
 
         fileChooser->launchAsync(juce::FileBrowserComponent::saveMode,
             [this](const juce::FileChooser& chooser)
@@ -326,10 +431,10 @@ void GrooveSequencerAudioProcessorEditor::setupFileControls()
     addAndMakeVisible(loadButton);
     loadButton.setButtonText("Load Pattern");
     loadButton.onClick = [this]() {
-        auto fileChooser = std::make_unique<juce::FileChooser>(
+        fileChooser = std::make_unique<juce::FileChooser>(
             "Load Pattern",
             juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
-            "*.xml");
+            "*.gsp;*.pattern");
 
         fileChooser->launchAsync(juce::FileBrowserComponent::openMode,
             [this](const juce::FileChooser& chooser)
@@ -359,6 +464,16 @@ void GrooveSequencerAudioProcessorEditor::timerCallback()
         playStopButton.setButtonText(processor.isPlaying() ? "Stop" : "Play");
     }
     
+    undoButton.setEnabled(processor.canUndoPatternEdit());
+    redoButton.setEnabled(processor.canRedoPatternEdit());
+    
+    // The host may move the Track parameter as well
+    if (processor.getSelectedTrack() != shownTrack)
+        showTrack(processor.getSelectedTrack());
+    
+    // The transport source also changes when the host restores a state
+    syncButton.setToggleState(processor.getTransportSource() == TransportSource::Host, juce::dontSendNotification);
+    
     // Update grid sequencer
     if (gridSequencer) {
         gridSequencer->repaint();
@@ -401,13 +516,7 @@ void GrooveSequencerAudioProcessorEditor::updateMidiMonitor(const juce::String&
 void GrooveSequencerAudioProcessorEditor::handleComboBoxChange(juce::ComboBox* comboBox)
 {
     if (comboBox == &divisionSelector)
-    {
-        const int selectedId = comboBox->getSelectedId();
-        NoteDivision division = NoteDivision::Sixteenth;
-        if (selectedId == 1) division = NoteDivision::Quarter;
-        else if (selectedId == 2) division = NoteDivision::Eighth;
-        processor.setNoteDivision(division);
-    }
+        processor.setTrackDivision(processor.getSelectedTrack(), divisionFromItemId(comboBox->getSelectedId()));
 }
 
 void GrooveSequencerAudioProcessorEditor::handleButtonClick(juce::Button* button)
@@ -418,10 +527,10 @@ void GrooveSequencerAudioProcessorEditor::handleButtonClick(juce::Button* button
     }
     else if (button == &saveButton)
     {
-        auto fileChooser = std::make_unique<juce::FileChooser>(
+        fileChooser = std::make_unique<juce::FileChooser>(
             "Save Pattern",
             juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
-            "*.xml");
+            "*.gsp;*.pattern");
 
         fileChooser->launchAsync(juce::FileBrowserComponent::saveMode,
             [this](const juce::FileChooser& chooser)
@@ -435,10 +544,10 @@ void GrooveSequencerAudioProcessorEditor::handleButtonClick(juce::Button* button
     }
     else if (button == &loadButton)
     {
-        auto fileChooser = std::make_unique<juce::FileChooser>(
+        fileChooser = std::make_unique<juce::FileChooser>(
             "Load Pattern",
             juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
-            "*.xml");
+            "*.gsp;*.pattern");
 
         fileChooser->launchAsync(juce::FileBrowserComponent::openMode,
             [this](const juce::FileChooser& chooser)
@@ -29,6 +29,7 @@ private:
     // Transport controls
     juce::TextButton playStopButton;
     juce::TextButton loopButton;
+    juce::TextButton syncButton;
     juce::Label tempoLabel;
     juce::Slider tempoSlider;
     juce::Label swingLabel;
@@ -42,6 +43,14 @@ private:
     juce::Label lengthLabel;
     juce::Slider lengthSlider;
     
+    // Track controls, addressing the track picked in the selector
+    juce::Label trackLabel;
+    juce::ComboBox trackSelector;
+    juce::ComboBox channelSelector;
+    juce::ToggleButton trackEnabledButton;
+    juce::TextButton copyToTrackButton;
+    int shownTrack{-1};
+    
     // Articulation controls
     juce::Label velocityLabel;
     juce::Slider velocityScaleSlider;
@@ -59,10 +68,13 @@ private:
     juce::ComboBox articulationStyleSelector;
     juce::TextButton generateButton;
     juce::TextButton transformButton;
+    juce::TextButton undoButton;
+    juce::TextButton redoButton;
     
     // File controls
     juce::TextButton saveButton;
     juce::TextButton loadButton;
+    std::unique_ptr<juce::FileChooser> fileChooser;   // Kept alive while its dialog is open
     juce::Label midiInputLabel;
     juce::TextEditor midiMonitor;
     
@@ -72,16 +84,20 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> velocityAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> gateAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lengthAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> trackAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> trackEnabledAttachment;
     
     // Setup methods
     void setupTransportControls();
     void setupGridControls();
+    void setupTrackControls();
     void setupArticulationControls();
     void setupPatternControls();
     void setupFileControls();
     
     // Update methods
     void updateGridSize();
+    void showTrack(int track);
     void updatePlayState();
     void updateMidiMonitor(const juce::String& message);
     
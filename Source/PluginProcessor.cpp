@@ -1,5 +1,16 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "PatternDeltaCodec.h"
+#include "PatternJsonReader.h"
+
+namespace {
+    constexpr int kFileShutdownTimeoutMs = 200;
+
+    bool isJsonPatternFile(const juce::File& file)
+    {
+        return file.hasFileExtension(".pattern;.json");
+    }
+}
 
 namespace IDs {
     const juce::String tempo{"tempo"};
@@ -8,24 +19,20 @@ namespace IDs {
 }
 
 GrooveSequencerAudioProcessor::GrooveSequencerAudioProcessor()
-    : AudioProcessor(BusesProperties()
-        .withInput("Input", juce::AudioChannelSet::stereo(), true)
-        .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+    : AudioProcessor(kHasInternalSynth
+        ? BusesProperties()
+            .withInput("Input", juce::AudioChannelSet::stereo(), true)
+            .withOutput("Output", juce::AudioChannelSet::stereo(), true)
+        : BusesProperties()),
       state(*this, nullptr, "Parameters", Parameters::createParameterLayout()),
       currentPattern(static_cast<int>(Parameters::DEFAULT_LENGTH)),
       transformer(),
       loopMode(true),
       playing(false),
-      currentPosition(0.0),
       sampleRate(44100.0),
-      samplesPerBeat(0),
       currentStep(-1),
       currentGridSize(0.25),
-      swingAmount(0.0),
-      velocityScale(1.0),
-      gateLength(0.5),
       patternModified(false),
-      division(NoteDivision::Sixteenth),
       isRecording(false),
       transformationType(TransformationType::RandomInKey),
       rhythmPattern(RhythmPattern::Regular),
@@ -33,18 +40,26 @@ GrooveSequencerAudioProcessor::GrooveSequencerAudioProcessor()
       midiBuffer(),
       floatBuffer(2, 512)  // Default buffer size
 {
+    tempoParameter = state.getRawParameterValue(Parameters::TEMPO_ID);
+    swingParameter = state.getRawParameterValue(Parameters::SWING_ID);
+    velocityParameter = state.getRawParameterValue(Parameters::VELOCITY_ID);
+    gateParameter = state.getRawParameterValue(Parameters::GATE_ID);
+    lengthParameter = state.getRawParameterValue(Parameters::LENGTH_ID);
+    oscillatorParameter = state.getRawParameterValue(Parameters::OSCILLATOR_ID);
+    voiceStealingParameter = state.getRawParameterValue(Parameters::VOICE_STEALING_ID);
+    polyphonyParameter = state.getRawParameterValue(Parameters::POLYPHONY_ID);
+    selectedTrackParameter = state.getRawParameterValue(Parameters::TRACK_ID);
+    for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+        trackEnabledParameters[static_cast<size_t>(track)] = state.getRawParameterValue(Parameters::getTrackEnabledId(track));
+    
     // Set up file logger
     juce::File logFile = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
                             .getChildFile("GrooveSequencer")
                             .getChildFile("groove_sequencer.log");
     
-    // Create directory if it doesn't exist
-    if (!logFile.getParentDirectory().exists())
-        logFile.getParentDirectory().createDirectory();
-    
-    // Create and set the logger (keeping last 10 logs, max 1MB each)
-    fileLogger = std::make_unique<juce::FileLogger>(logFile, "GrooveSequencer Plugin Initialized");
-    juce::Logger::setCurrentLogger(fileLogger.get());
+    // Audio-thread records are formatted and flushed by the logger's own thread
+    logger = std::make_unique<RealtimeLogger>(logFile, "GrooveSequencer Plugin Initialized");
+    juce::Logger::setCurrentLogger(&logger->getFileLogger());
     
     juce::Logger::writeToLog("GrooveSequencer plugin initialized");
     
@@ -59,290 +74,611 @@ GrooveSequencerAudioProcessor::GrooveSequencerAudioProcessor()
     // Initialize with a default empty pattern
     generateNewPattern();
     
-    fileLogger->logMessage("Plugin initialized with default pattern length: " + juce::String(getLength()));
+    regenerationWorker = std::make_unique<CoalescingWorker>("GrooveSequencer Pattern Worker",
+                                                            [this] { regeneratePattern(); });
+    patternFileThread = std::make_unique<juce::ThreadPool>(1);
+    
+    // Picks up notes recorded on the audio thread
+    startTimerHz(30);
+    
+    logger->log(LogLevel::Info, "Plugin initialized with default pattern length: " + juce::String(getLength()));
 }
 
 GrooveSequencerAudioProcessor::~GrooveSequencerAudioProcessor()
 {
-    juce::Logger::writeToLog("GrooveSequencer plugin shutting down");
-    juce::Logger::setCurrentLogger(nullptr);
+    stopTimer();
     
+    // Parameter changes request regeneration, so stop them before the worker goes
     state.removeParameterListener(Parameters::TEMPO_ID, this);
     state.removeParameterListener(Parameters::GRID_SIZE_ID, this);
     state.removeParameterListener(Parameters::LENGTH_ID, this);
     state.removeParameterListener(Parameters::SWING_ID, this);
     state.removeParameterListener(Parameters::VELOCITY_ID, this);
     state.removeParameterListener(Parameters::GATE_ID, this);
+    regenerationWorker.reset();
     
-    if (playing)
-        stopAllNotes();
+    // Jobs not yet started are dropped, so closing the plugin never waits behind a
+    // queue of saves; one already running still finishes, as it uses this processor
+    patternFileThread->removeAllJobs(true, kFileShutdownTimeoutMs);
+    patternFileThread.reset();
+    
+    juce::Logger::writeToLog("GrooveSequencer plugin shutting down");
+    juce::Logger::setCurrentLogger(nullptr);
 }
 
 void GrooveSequencerAudioProcessor::prepareToPlay(double newSampleRate, int samplesPerBlock)
 {
     sampleRate = newSampleRate;
     floatBuffer.setSize(2, samplesPerBlock);
-    updatePlaybackPosition(0);
+    
+    // Reserve the output event storage up front so the audio thread never grows it
+    midiBuffer.ensureSize(kMidiOutputBufferBytes);
+    spareMidiBuffer.ensureSize(kMidiOutputBufferBytes);
+    
+    if constexpr (kHasInternalSynth)
+        voiceBank.prepare(newSampleRate, samplesPerBlock);
 }
 
 void GrooveSequencerAudioProcessor::releaseResources()
 {
-    stopAllNotes();
+    // The host never calls this while processBlock is running
+    stopRequested = false;
+    releaseAllVoices();
 }
 
 bool GrooveSequencerAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
+    // The MIDI effect has no audio buses to negotiate
+    if constexpr (!kHasInternalSynth)
+        return true;
+    
     return layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo();
 }
 
+namespace {
+    constexpr juce::int64 kNoTick = std::numeric_limits<juce::int64>::min() / 2;
+}
+
 void GrooveSequencerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     buffer.clear();
     
-    // Handle MIDI messages and start/stop notes
-    for (const auto metadata : midiMessages) {
-        const auto msg = metadata.getMessage();
-        if (msg.isNoteOn()) {
-            auto* voice = findFreeVoice();
-            if (voice != nullptr) {
-                voice->startNote(static_cast<float>(msg.getNoteNumber()), msg.getFloatVelocity());
-                fileLogger->logMessage("Starting note: " + juce::String(msg.getNoteNumber()) + 
-                                     " velocity: " + juce::String(msg.getFloatVelocity()));
+    // Pick up the latest tracks published by the editing threads; regenerated
+    // patterns wait for the main track's loop boundary while it is playing
+    const bool swapped = patternSnapshots.acquireLatest(!playing || patternSnapshots.getLive().getMainPattern().isEmpty());
+    const bool retimed = refreshTimingPlan();
+    
+    // A track that was just enabled has to be placed on the playhead before it can fire
+    const juce::uint32 enabledMask = readTrackEnabledMask();
+    const bool tracksEnabled = (enabledMask & ~trackEnabledMask) != 0;
+    trackEnabledMask = enabledMask;
+    
+    // In host mode the play state and position come from the host every block
+    const bool wasFollowingHost = followingHost;
+    followingHost = getTransportSource() == TransportSource::Host && syncToHostPlayhead(buffer.getNumSamples());
+    
+    applySynthParameters();
+    
+    // Transport was stopped from another thread since the last block; voices are
+    // only ever touched here, on the audio thread
+    if (stopRequested.exchange(false)) {
+        currentStep = -1;
+        flushPendingNoteOffs(0);
+        releaseAllVoices();
+    }
+    
+    // Idle fast path: nothing sounding, scheduled or incoming, so the cleared buffer is the output
+    const bool hasSoundingNotes = !pendingNoteOffs.isEmpty() || (kHasInternalSynth && voiceBank.hasActiveVoices());
+    if (!playing && midiMessages.isEmpty() && midiBuffer.isEmpty() && !hasSoundingNotes) {
+        sampleClock += buffer.getNumSamples();
+        return;
+    }
+    
+    // Transport was stopped by the host or at the end of the pattern
+    if (!playing)
+        flushPendingNoteOffs(0);
+    
+    // Falling back from the host's clock restarts the internal one from the top
+    if (wasFollowingHost && !followingHost)
+        currentStep = -1;
+    
+    // Place every clocked track's next event: from the top on a fresh internal start,
+    // from the playhead every block in host mode, and again whenever the tracks or
+    // their timing change underneath a running clock
+    if (playing && !followingHost && currentStep < 0)
+        startInternalTransport(0);
+    else if (playing && (followingHost || swapped || retimed || tracksEnabled))
+        locateTracks();
+    
+    // Handle MIDI messages and start/stop notes; the MIDI effect passes them through untouched
+    if constexpr (kHasInternalSynth) {
+        for (const auto metadata : midiMessages) {
+            const auto msg = metadata.getMessage();
+            if (msg.isNoteOn()) {
+                const int voice = voiceBank.noteOn(VoiceAllocator::getLiveSource(msg.getChannel()),
+                                                   msg.getNoteNumber(), msg.getFloatVelocity());
+                GS_RT_LOG(*logger, LogLevel::Debug, "Starting note: {} velocity: {} on voice {}",
+                          msg.getNoteNumber(), msg.getFloatVelocity(), voice);
             }
-        }
-        else if (msg.isNoteOff()) {
-            for (auto& voice : voices) {
-                if (voice.isActive() && voice.getCurrentNote() == msg.getNoteNumber()) {
-                    voice.stopNote();
-                    fileLogger->logMessage("Stopping note: " + juce::String(msg.getNoteNumber()));
-                }
+            else if (msg.isNoteOff()) {
+                voiceBank.noteOff(VoiceAllocator::getLiveSource(msg.getChannel()), msg.getNoteNumber());
+                GS_RT_LOG(*logger, LogLevel::Debug, "Stopping note: {}", msg.getNoteNumber());
             }
-        }
-        else if (msg.isAllNotesOff()) {
-            for (auto& voice : voices) {
-                voice.stopNote();
+            else if (msg.isAllNotesOff()) {
+                voiceBank.stopAll();
+                GS_RT_LOG(*logger, LogLevel::Debug, "Stopping all notes");
             }
-            fileLogger->logMessage("Stopping all notes");
         }
     }
     
-    // Generate audio
-    auto* leftChannel = buffer.getWritePointer(0);
-    auto* rightChannel = buffer.getWritePointer(1);
+    // Render the block in segments split at every track event and gate end
+    // that falls inside it, so each event lands on its exact sample offset
+    const int numSamples = buffer.getNumSamples();
+    int sample = 0;
     
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample) {
-        float currentSample = 0.0f;
+    // Incoming notes are recorded from inside the loop, on their own sample, once the
+    // steps due at or before it have fired
+    auto nextInput = midiMessages.cbegin();
+    
+    while (sample < numSamples) {
+        int segmentLength = numSamples - sample;
+        
+        // Gates that end at or before this sample, including ones started in earlier blocks
+        pendingNoteOffs.popDue(sampleClock + 1, [this, sample](int channel, int note) {
+            sendSequencerNoteOff(channel, note, sample);
+        });
+        if (!pendingNoteOffs.isEmpty())
+            segmentLength = static_cast<int>(juce::jmin(static_cast<juce::int64>(segmentLength),
+                                                        pendingNoteOffs.getNextTime() - sampleClock));
         
-        // Mix all active voices
-        for (auto& voice : voices) {
-            if (voice.isActive()) {
-                currentSample += voice.getNextSample();
+        if (playing) {
+            const juce::int64 nextEventTime = getNextTrackEventTime();
+            if (nextEventTime <= sampleClock) {
+                fireDueTrackEvents(sample);
+                continue;
             }
+            segmentLength = static_cast<int>(juce::jmin(static_cast<juce::int64>(segmentLength), nextEventTime - sampleClock));
         }
         
-        // Apply simple limiter to prevent clipping
-        currentSample = juce::jlimit(-0.8f, 0.8f, currentSample);
+        if (playing && isRecording) {
+            for (; nextInput != midiMessages.cend() && (*nextInput).samplePosition <= sample; ++nextInput)
+                handleMidiInput((*nextInput).getMessage());
+            if (nextInput != midiMessages.cend())
+                segmentLength = juce::jmin(segmentLength, (*nextInput).samplePosition - sample);
+        }
         
-        leftChannel[sample] = currentSample;
-        rightChannel[sample] = currentSample;
+        renderVoices(buffer, sample, segmentLength);
+        sample += segmentLength;
+        sampleClock += segmentLength;
     }
     
-    if (playing) {
-        const auto numSamples = buffer.getNumSamples();
-        updatePlaybackPosition(numSamples);
-        
-        if (isRecording) {
-            // Handle incoming MIDI for recording
-            for (const auto metadata : midiMessages) {
-                handleMidiInput(metadata.getMessage());
-            }
-        }
+    // Merge the host's events into the sequencer's reserved buffer and swap the two,
+    // so the host's buffer is never grown here. The host's storage comes back in its
+    // place; one smaller than the reserve is parked in the spare, so a host that
+    // reuses its buffer ends up cycling only reserved storage. clear() keeps it all.
+    midiBuffer.addEvents(midiMessages, 0, numSamples, 0);
+    midiMessages.swapWith(midiBuffer);
+    midiBuffer.clear();
+    if (static_cast<size_t>(midiBuffer.data.getNumAllocated()) < kMidiOutputBufferBytes)
+        midiBuffer.swapWith(spareMidiBuffer);
+}
+
+void GrooveSequencerAudioProcessor::applySynthParameters()
+{
+    if constexpr (!kHasInternalSynth)
+        return;
+    
+    // Read every block, so host automation and restored state both reach the voices
+    voiceBank.setOscillatorMode(static_cast<OscillatorMode>(juce::roundToInt(oscillatorParameter->load())));
+    voiceBank.setStealingPolicy(static_cast<VoiceStealingPolicy>(juce::roundToInt(voiceStealingParameter->load())));
+    
+    // Resizing the bank silences it, so only do so when the polyphony actually changed
+    const int numVoices = juce::jlimit(1, VoiceBank::kMaxVoices, juce::roundToInt(polyphonyParameter->load()));
+    if (numVoices != voiceBank.getNumVoices()) {
+        voiceBank.setNumVoices(numVoices);
+        GS_RT_LOG(*logger, LogLevel::Debug, "Polyphony set to {} voices", numVoices);
     }
 }
 
-void GrooveSequencerAudioProcessor::updatePlaybackPosition(int numSamples)
+void GrooveSequencerAudioProcessor::renderVoices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
 {
-    if (!playing) return;
+    if constexpr (!kHasInternalSynth)
+        return;
+    
+    // Silent segments stay cleared; not taking write pointers keeps the buffer's
+    // hasBeenCleared() flag set, which is how a silent block is signalled downstream
+    if (!voiceBank.hasActiveVoices())
+        return;
+    
+    auto* leftChannel = buffer.getWritePointer(0, startSample);
+    auto* rightChannel = buffer.getWritePointer(1, startSample);
+    
+    // Mix all active voices into the (cleared) left channel
+    voiceBank.renderBlock(leftChannel, numSamples);
+    
+    // Apply simple limiter to prevent clipping
+    juce::FloatVectorOperations::clip(leftChannel, leftChannel, -0.8f, 0.8f, numSamples);
+    juce::FloatVectorOperations::copy(rightChannel, leftChannel, numSamples);
+}
 
-    // Calculate timing values
-    const double beatsPerMinute = getTempo();
-    const double beatsPerSecond = beatsPerMinute / 60.0;
-    const double samplesPerBeat = sampleRate / beatsPerSecond;
+bool GrooveSequencerAudioProcessor::refreshTimingPlan()
+{
+    const TimingPlan::Inputs inputs{
+        sampleRate,
+        tempoParameter->load(std::memory_order_relaxed),
+        swingParameter->load(std::memory_order_relaxed),
+        gateParameter->load(std::memory_order_relaxed)
+    };
+    
+    if (inputs == timingPlan.inputs)
+        return false;
+    
+    const auto newPlan = TimingPlan::build(inputs);
     
-    // Calculate samples per step based on the division
-    double divisionValue;
-    switch (division) {
-        case NoteDivision::Quarter: 
-            divisionValue = 4.0; 
-            break;
-        case NoteDivision::Eighth: 
-            divisionValue = 8.0; 
-            break;
-        case NoteDivision::Sixteenth: 
-            divisionValue = 16.0; 
-            break;
-        default: 
-            divisionValue = 16.0; 
-            break;
+    // Re-anchor at the current tick so a new tick length takes over from here
+    // without moving any step that has already played
+    if (!newPlan.hasSameGrid(timingPlan) && playing && !followingHost && currentStep >= 0 && timingPlan.tickNumerator > 0)
+    {
+        const juce::int64 tick = getCurrentTick();
+        gridAnchorSample = getTickStartSample(tick);
+        gridAnchorTick = tick;
     }
     
-    const double samplesPerStep = samplesPerBeat / (divisionValue / 4.0); // Normalize to quarter notes
+    timingPlan = newPlan;
+    return true;
+}
+
+juce::int64 GrooveSequencerAudioProcessor::getCurrentTick() const
+{
+    // Last tick that starts at or before the current sample
+    return gridAnchorTick + MathUtils::floorDivide((sampleClock - gridAnchorSample) * timingPlan.tickDenominator, timingPlan.tickNumerator);
+}
+
+juce::int64 GrooveSequencerAudioProcessor::getTickStartSample(juce::int64 tick) const
+{
+    return gridAnchorSample + MathUtils::floorDivide((tick - gridAnchorTick) * timingPlan.tickNumerator, timingPlan.tickDenominator);
+}
+
+juce::int64 GrooveSequencerAudioProcessor::getTrackStepStartSample(int track, juce::int64 step) const
+{
+    const int ticksPerStep = patternSnapshots.getLive().ticksPerStep[static_cast<size_t>(track)];
+    const juce::int64 gridSample = getTickStartSample(step * ticksPerStep);
+    return gridSample + ((step & 1) != 0 ? timingPlan.getSwingOffsetSamples(ticksPerStep) : 0);
+}
+
+void GrooveSequencerAudioProcessor::startInternalTransport(int sampleOffset)
+{
+    // Starting from the top, so nothing from an earlier run may ring on
+    gridAnchorTick = 0;
+    gridAnchorSample = sampleClock;
+    trackLastSubtick.fill(kNoTick);
+    mainOriginSubtick = 0;
+    flushPendingNoteOffs(sampleOffset);
+    patternSnapshots.acquireLatest(true);
     
-    // Add swing if enabled (only on even-numbered steps)
-    const double swingOffset = (currentStep % 2 == 1) ? swingAmount * samplesPerStep * 0.5 : 0.0;
+    currentStep = 0;
+    mainStepStartClock = sampleClock;
+    mainStepBeat = 0.0;
+    locateTracks();
     
-    // Update position
-    currentPosition += numSamples;
+    GS_RT_LOG(*logger, LogLevel::Debug, "Internal transport started at {} bpm", timingPlan.inputs.tempo);
+}
+
+bool GrooveSequencerAudioProcessor::syncToHostPlayhead(int numSamples)
+{
+    auto* playHead = getPlayHead();
+    if (playHead == nullptr)
+        return false;
     
-    // Check if we need to advance to the next step
-    if (currentPosition >= samplesPerStep + swingOffset)
-    {
-        currentPosition -= (samplesPerStep + swingOffset);
-        const int previousStep = currentStep;
-        currentStep++;
-        
-        // Handle loop point
-        const int patternLength = static_cast<int>(currentPattern.getNotes().size());
-        if (currentStep >= patternLength)
-        {
-            if (loopMode)
-            {
-                currentStep = 0;
-                currentPosition = 0.0;
-                fileLogger->logMessage("Pattern loop point reached, restarting from step 0");
-            }
-            else
-            {
-                stopPlayback();
-                fileLogger->logMessage("End of pattern reached, stopping playback");
-                return;
-            }
-        }
-        
-        fileLogger->logMessage("Step advanced: " + juce::String(previousStep) + " -> " + 
-                             juce::String(currentStep) + 
-                             " (position: " + juce::String(currentPosition, 2) + 
-                             " samples, tempo: " + juce::String(beatsPerMinute, 1) + 
-                             " BPM, swing: " + juce::String(swingAmount, 2) + ")");
-        
-        triggerNotesForCurrentStep();
+    const auto position = playHead->getPosition();
+    if (!position.hasValue())
+        return false;
+    
+    const auto ppq = position->getPpqPosition();
+    const auto bpm = position->getBpm();
+    if (!ppq.hasValue() || !bpm.hasValue() || *bpm <= 0.0)
+        return false;
+    
+    const bool wasPlaying = playing;
+    const bool hostPlaying = position->getIsPlaying();
+    
+    hostBlockStartPpq = *ppq;
+    hostSamplesPerPpq = sampleRate * 60.0 / *bpm;
+    hostBlockStartClock = sampleClock;
+    
+    // A seek, loop or restart moves the playhead somewhere other than where the
+    // last block ended; anything still gated belongs to the old position
+    const bool jumped = !wasPlaying || std::abs(hostBlockStartPpq - expectedHostPpq) * hostSamplesPerPpq > 1.0;
+    expectedHostPpq = hostBlockStartPpq + numSamples / hostSamplesPerPpq;
+    
+    playing = hostPlaying;
+    if (!hostPlaying) {
+        currentStep = -1;
+        return true;
+    }
+    
+    if (jumped) {
+        flushPendingNoteOffs(0);
+        trackLastSubtick.fill(kNoTick);
+        mainOriginSubtick = 0;
+        GS_RT_LOG(*logger, LogLevel::Debug, "Host transport jumped to ppq {} at {} bpm", hostBlockStartPpq, *bpm);
     }
+    
+    return true;
 }
 
-void GrooveSequencerAudioProcessor::triggerNotesForCurrentStep()
+double GrooveSequencerAudioProcessor::getHostStepStartPpq(int track, juce::int64 step) const
 {
-    const juce::ScopedLock sl(patternLock);
-    const auto& notes = currentPattern.getNotes();
+    const int ticksPerStep = patternSnapshots.getLive().ticksPerStep[static_cast<size_t>(track)];
+    const double swingOffset = (step & 1) != 0 ? timingPlan.swingOffsetPpq * ticksPerStep : 0.0;
+    return static_cast<double>(step * ticksPerStep) * timingPlan.tickLengthPpq + swingOffset;
+}
+
+juce::uint32 GrooveSequencerAudioProcessor::readTrackEnabledMask() const
+{
+    juce::uint32 mask = 0;
+    for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+        if (trackEnabledParameters[static_cast<size_t>(track)]->load(std::memory_order_relaxed) >= 0.5f)
+            mask |= juce::uint32{1} << track;
     
-    if (currentStep < 0 || currentStep >= static_cast<int>(notes.size()))
-    {
-        fileLogger->logMessage("Invalid step index: " + juce::String(currentStep) + 
-                             " (pattern size: " + juce::String(notes.size()) + ")");
+    return mask;
+}
+
+juce::uint32 GrooveSequencerAudioProcessor::getAudibleTracks() const
+{
+    return patternSnapshots.getLive().audibleMask & trackEnabledMask;
+}
+
+juce::uint32 GrooveSequencerAudioProcessor::getClockedTracks() const
+{
+    // A disabled main track still drives the loop point
+    constexpr auto mainBit = juce::uint32{1} << TrackConstants::MAIN_TRACK;
+    return patternSnapshots.getLive().clockedMask & (trackEnabledMask | mainBit);
+}
+
+juce::int64 GrooveSequencerAudioProcessor::getTrackOrigin(int track) const
+{
+    // Where the track's pattern position 0 sits on its timeline. Only the main
+    // track restarts its pattern at a swap; the origin is always a loop boundary,
+    // so it divides exactly by any track division
+    if (track != TrackConstants::MAIN_TRACK)
+        return 0;
+    
+    return mainOriginSubtick / patternSnapshots.getLive().ticksPerStep[TrackConstants::MAIN_TRACK];
+}
+
+juce::int64 GrooveSequencerAudioProcessor::getTrackPositionSample(int track, juce::int64 position) const
+{
+    // Positions between step starts are interpolated, so an off-grid note keeps
+    // its place within a swung step
+    constexpr auto unitsPerStep = CompiledPattern::kUnitsPerStep;
+    position += getTrackOrigin(track);
+    const juce::int64 step = MathUtils::floorDivide(position, unitsPerStep);
+    const juce::int64 fraction = position - step * unitsPerStep;
+    
+    if (followingHost) {
+        const double stepStart = getHostStepStartPpq(track, step);
+        const double stepEnd = getHostStepStartPpq(track, step + 1);
+        const double ppq = stepStart + (stepEnd - stepStart) * static_cast<double>(fraction) / unitsPerStep;
+        return hostBlockStartClock + static_cast<juce::int64>(std::ceil((ppq - hostBlockStartPpq) * hostSamplesPerPpq));
+    }
+    
+    const juce::int64 stepStart = getTrackStepStartSample(track, step);
+    if (fraction == 0)
+        return stepStart;
+    
+    return stepStart + (getTrackStepStartSample(track, step + 1) - stepStart) * fraction / unitsPerStep;
+}
+
+void GrooveSequencerAudioProcessor::locateTracks()
+{
+    for (auto bits = getClockedTracks(); bits != 0; bits &= bits - 1)
+        locateTrack(BitUtils::countTrailingZeros(bits));
+}
+
+void GrooveSequencerAudioProcessor::locateTrack(int track)
+{
+    const auto t = static_cast<size_t>(track);
+    const auto& live = patternSnapshots.getLive();
+    const auto& pattern = live.patterns[t];
+    const int ticksPerStep = live.ticksPerStep[t];
+    
+    // Search from a step before the playhead, but never at or before the last
+    // position fired, even if the track's division has changed since
+    const juce::int64 playheadStep = followingHost
+        ? static_cast<juce::int64>(std::floor(hostBlockStartPpq / (timingPlan.tickLengthPpq * ticksPerStep)))
+        : MathUtils::floorDivide(getCurrentTick(), ticksPerStep);
+    const juce::int64 fromPosition = juce::jmax((playheadStep - 1) * CompiledPattern::kUnitsPerStep,
+                                                MathUtils::floorDivide(trackLastSubtick[t], ticksPerStep) + 1);
+    
+    // Binary search to the neighbourhood, then step over the few events still behind the playhead
+    juce::int64 event = pattern.findEvent(fromPosition - getTrackOrigin(track));
+    while (getTrackPositionSample(track, pattern.getPosition(event)) < sampleClock)
+        ++event;
+    
+    trackNextEvent[t] = event;
+    trackNextEventTime[t] = getTrackPositionSample(track, pattern.getPosition(event));
+}
+
+juce::int64 GrooveSequencerAudioProcessor::getNextTrackEventTime() const
+{
+    juce::int64 earliest = std::numeric_limits<juce::int64>::max();
+    for (auto bits = getClockedTracks(); bits != 0; bits &= bits - 1)
+        earliest = juce::jmin(earliest, trackNextEventTime[static_cast<size_t>(BitUtils::countTrailingZeros(bits))]);
+    
+    return earliest;
+}
+
+void GrooveSequencerAudioProcessor::fireDueTrackEvents(int sampleOffset)
+{
+    constexpr auto mainTrack = TrackConstants::MAIN_TRACK;
+    constexpr auto mainBit = juce::uint32{1} << mainTrack;
+    
+    // The main track goes first: its loop point may swap in new tracks for everyone
+    if ((getClockedTracks() & mainBit) != 0
+        && trackNextEventTime[mainTrack] <= sampleClock && !advanceMainTrack(sampleOffset))
         return;
+    
+    for (auto bits = getAudibleTracks() & ~mainBit; bits != 0; bits &= bits - 1) {
+        const int track = BitUtils::countTrailingZeros(bits);
+        if (trackNextEventTime[static_cast<size_t>(track)] <= sampleClock)
+            fireTrackEvent(track, sampleOffset);
     }
+}
 
-    const auto& note = notes[static_cast<size_t>(currentStep)];
-    if (note.active)
-    {
-        // Stop any currently playing notes
-        stopAllNotes();
-        
-        // Start the note with velocity scaling
-        auto* voice = findFreeVoice();
-        if (voice != nullptr)
-        {
-            float velocity = static_cast<float>((note.velocity / 127.0f) * velocityScale);
-            voice->startNote(static_cast<float>(note.pitch), velocity);
-            fileLogger->logMessage("Playing note: pitch=" + juce::String(note.pitch) + 
-                               " velocity=" + juce::String(velocity) +
-                               " accent=" + juce::String(note.accent) +
-                               " staccato=" + juce::String(note.isStaccato ? 1 : 0) +
-                               " at step " + juce::String(currentStep));
-        }
-        else
-        {
-            fileLogger->logMessage("No free voice available for step " + juce::String(currentStep));
+bool GrooveSequencerAudioProcessor::advanceMainTrack(int sampleOffset)
+{
+    constexpr auto mainTrack = TrackConstants::MAIN_TRACK;
+    const auto& pattern = patternSnapshots.getLive().getMainPattern();
+    const juce::int64 event = trackNextEvent[mainTrack];
+    const juce::int64 loop = pattern.getLoop(event);
+    const int index = pattern.getIndex(event);
+    
+    // The main track's timeline decides where the loop boundary falls; swapped-in
+    // tracks may have new timelines, so every lane is placed again before firing.
+    // The new main pattern starts from its first event on this boundary, rather
+    // than wherever the absolute playhead falls within its loop
+    if (index == 0) {
+        const juce::int64 boundarySubtick = (getTrackOrigin(mainTrack) + pattern.getPosition(event))
+                                            * patternSnapshots.getLive().ticksPerStep[mainTrack];
+        if (patternSnapshots.acquireLatest(true)) {
+            GS_RT_LOG(*logger, LogLevel::Debug, "Swapped in new tracks at loop point");
+            mainOriginSubtick = boundarySubtick;
+            locateTracks();
+            trackNextEvent[mainTrack] = 0;
+            trackNextEventTime[mainTrack] = sampleClock;
+            return true;
         }
     }
-    else
-    {
-        fileLogger->logMessage("Step " + juce::String(currentStep) + " is inactive");
+    
+    // Without looping the pattern plays once: the internal clock stops at the end
+    // of the first loop, the host's clock only plays it from its zero onwards
+    if (!loopMode && loop != 0) {
+        if (!followingHost && loop > 0) {
+            playing = false;
+            currentStep = -1;
+            flushPendingNoteOffs(sampleOffset);
+            releaseAllVoices();
+            GS_RT_LOG(*logger, LogLevel::Info, "End of pattern reached, stopping playback");
+            return false;
+        }
+    } else if (const int noteIndex = pattern.noteIndices[static_cast<size_t>(index)]; noteIndex >= 0) {
+        const int previousStep = currentStep;
+        currentStep = noteIndex;
+        mainStepStartClock = sampleClock;
+        mainStepBeat = static_cast<double>(pattern.positions[static_cast<size_t>(index)])
+                       / static_cast<double>(CompiledPattern::kStepsPerBeat * CompiledPattern::kUnitsPerStep);
+        GS_RT_LOG(*logger, LogLevel::Debug, "Step advanced: {} -> {} (clock: {} samples, swing: {})",
+                  previousStep, currentStep, sampleClock, timingPlan.inputs.swing);
     }
+    
+    fireTrackEvent(mainTrack, sampleOffset);
+    return true;
 }
 
-void GrooveSequencerAudioProcessor::sendNoteEvents()
+void GrooveSequencerAudioProcessor::fireTrackEvent(int track, int sampleOffset)
 {
-    const juce::ScopedLock sl(patternLock);
-    const auto& notes = currentPattern.getNotes();
+    const auto t = static_cast<size_t>(track);
+    const auto& live = patternSnapshots.getLive();
+    const auto& pattern = live.patterns[t];
+    const juce::int64 event = trackNextEvent[t];
+    const juce::int64 position = pattern.getPosition(event);
+    
+    if ((getAudibleTracks() & (juce::uint32{1} << track)) != 0 && (loopMode || pattern.getLoop(event) == 0))
+        triggerTrackEvent(track, pattern.getIndex(event), sampleOffset);
     
-    const int step = static_cast<int>(currentPosition);
-    if (step != currentStep)
+    trackLastSubtick[t] = (position + getTrackOrigin(track)) * live.ticksPerStep[t];
+    trackNextEvent[t] = event + 1;
+    trackNextEventTime[t] = getTrackPositionSample(track, pattern.getPosition(event + 1));
+}
+
+void GrooveSequencerAudioProcessor::triggerTrackEvent(int track, int index, int sampleOffset)
+{
+    const auto& live = patternSnapshots.getLive();
+    const auto& note = live.patterns[static_cast<size_t>(track)].steps[static_cast<size_t>(index)];
+    const int channel = live.midiChannels[static_cast<size_t>(track)];
+    
+    if (!note.isActive())
     {
-        currentStep = step;
-        stopAllNotes();
-        
-        if (step >= 0 && step < static_cast<int>(notes.size()))
-        {
-            const auto& note = notes[static_cast<size_t>(step)];
-            if (note.active)  // Only send if note is active
-            {
-                const int velocity = static_cast<int>(note.velocity * velocityScale * 127.0f);
-                const int channel = 1;
-                const int noteNumber = note.pitch;
-                
-                // Apply accent if needed
-                const float accentMultiplier = note.accent > 0 ? 1.2f : 1.0f;
-                const int finalVelocity = static_cast<int>(juce::jlimit(1, 127, static_cast<int>(velocity * accentMultiplier)));
-                
-                midiBuffer.addEvent(juce::MidiMessage::noteOn(channel, noteNumber, static_cast<uint8>(finalVelocity)), 0);
-                
-                // Adjust gate length for staccato notes
-                const float effectiveGateLength = note.isStaccato ? static_cast<float>(gateLength * 0.5) : static_cast<float>(gateLength);
-                const int noteDuration = static_cast<int>(samplesPerBeat * effectiveGateLength);
-                midiBuffer.addEvent(juce::MidiMessage::noteOff(channel, noteNumber), noteDuration);
-                
-                fileLogger->logMessage("Sent MIDI note: step=" + juce::String(step) + 
-                                     " pitch=" + juce::String(noteNumber) + 
-                                     " velocity=" + juce::String(finalVelocity) + 
-                                     " accent=" + juce::String(note.accent) + 
-                                     " staccato=" + juce::String(note.isStaccato ? 1 : 0) + 
-                                     " duration=" + juce::String(noteDuration));
-            }
-        }
-        else
-        {
-            fileLogger->logMessage("Invalid step index in sendNoteEvents: " + juce::String(step));
-        }
+        GS_RT_LOG(*logger, LogLevel::Debug, "Track {} event {} is inactive", track, index);
+        return;
+    }
+    
+    // Retriggering a note that is still gated ends it first; other notes ring on
+    if (pendingNoteOffs.isHeld(channel, note.pitch)) {
+        pendingNoteOffs.cancel(channel, note.pitch);
+        sendSequencerNoteOff(channel, note.pitch, sampleOffset);
+    }
+    
+    // Scale velocity and apply accent
+    const float accentMultiplier = note.getAccent() > 0 ? 1.2f : 1.0f;
+    const float velocityScale = velocityParameter->load(std::memory_order_relaxed);
+    const int midiVelocity = juce::jlimit(1, 127, juce::roundToInt(note.getVelocity() * velocityScale * accentMultiplier));
+    
+    // Gate scales the note's duration in beats, halved for staccato notes, and
+    // may run past the end of the step; the host's tempo wins when following it
+    double gateSamplesPerBeat = note.isStaccato() ? timingPlan.staccatoGateSamplesPerBeat : timingPlan.gateSamplesPerBeat;
+    if (followingHost)
+        gateSamplesPerBeat *= hostSamplesPerPpq / timingPlan.samplesPerBeat;
+    const auto gateSamples = juce::jmax(juce::int64{1},
+        static_cast<juce::int64>(std::llround(note.duration * gateSamplesPerBeat)));
+    
+    // When full, end the earliest gate early rather than leave a note hanging
+    if (pendingNoteOffs.isFull())
+        pendingNoteOffs.popNext([this, sampleOffset](int c, int n) { sendSequencerNoteOff(c, n, sampleOffset); });
+    pendingNoteOffs.schedule(sampleClock + gateSamples, channel, note.pitch);
+    
+    midiBuffer.addEvent(juce::MidiMessage::noteOn(channel, note.pitch, static_cast<juce::uint8>(midiVelocity)),
+                        sampleOffset);
+    GS_RT_LOG(*logger, LogLevel::Debug, "Sent note: pitch={} velocity={} gate={} on track {}",
+              note.pitch, midiVelocity, gateSamples, track);
+    
+    if constexpr (kHasInternalSynth)
+    {
+        const int voice = voiceBank.noteOn(VoiceAllocator::getSequencerSource(channel), note.pitch,
+                                           static_cast<float>(midiVelocity) / 127.0f);
+        GS_RT_LOG(*logger, LogLevel::Debug, "Playing note: pitch={} accent={} on voice {}",
+                  note.pitch, note.getAccent(), voice);
     }
 }
 
 void GrooveSequencerAudioProcessor::stopAllNotes()
 {
-    for (auto& voice : voices) {
-        if (voice.isActive()) {
-            voice.stopNote();
-        }
-    }
+    stopRequested = true;
+}
+
+void GrooveSequencerAudioProcessor::releaseAllVoices()
+{
+    if constexpr (kHasInternalSynth)
+        voiceBank.stopAll();
+}
+
+void GrooveSequencerAudioProcessor::sendSequencerNoteOff(int channel, int note, int sampleOffset)
+{
+    midiBuffer.addEvent(juce::MidiMessage::noteOff(channel, note), sampleOffset);
+    
+    if constexpr (kHasInternalSynth)
+        voiceBank.noteOff(VoiceAllocator::getSequencerSource(channel), note);
+}
+
+void GrooveSequencerAudioProcessor::flushPendingNoteOffs(int sampleOffset)
+{
+    pendingNoteOffs.flush([this, sampleOffset](int channel, int note) { sendSequencerNoteOff(channel, note, sampleOffset); });
 }
 
 void GrooveSequencerAudioProcessor::startPlayback()
 {
-    if (!playing) {
-        playing = true;
-        currentStep = -1;  // Will advance to 0 on first update
-        currentPosition = 0.0;
-        juce::Logger::writeToLog("Starting playback at tempo: " + juce::String(getTempo()));
+    // The step was reset when playback last stopped, so the first block starts from the top
+    if (!playing.exchange(true)) {
+        logger->log(LogLevel::Info, "Starting playback at tempo: " + juce::String(getTempo()));
     }
 }
 
 void GrooveSequencerAudioProcessor::stopPlayback()
 {
-    if (playing) {
-        playing = false;
-        currentStep = -1;
-        currentPosition = 0.0;
+    if (playing.exchange(false)) {
         stopAllNotes();
-        juce::Logger::writeToLog("Stopping playback");
+        logger->log(LogLevel::Info, "Stopping playback");
     }
 }
 
@@ -352,22 +688,22 @@ void GrooveSequencerAudioProcessor::setPattern(const Pattern& pattern)
     
     // Validate pattern
     if (pattern.getNotes().empty()) {
-        fileLogger->logMessage("Warning: Attempting to set empty pattern");
+        logger->log(LogLevel::Warning, "Attempting to set empty pattern");
         return;
     }
     
     currentPattern = pattern;
-    patternModified = true;
+    commitPatternEdit();
     
-    fileLogger->logMessage("Pattern set with " + juce::String(currentPattern.getNotes().size()) + " notes");
+    logger->log(LogLevel::Info, "Pattern set with " + juce::String(currentPattern.getNoteCount()) + " notes");
     
     // Log first few notes for debugging
-    const auto& notes = currentPattern.getNotes();
+    const auto& notes = std::as_const(currentPattern).getNotes();
     for (size_t i = 0; i < std::min(static_cast<size_t>(4), notes.size()); ++i) {
         const auto& note = notes[i];
-        fileLogger->logMessage("Note " + juce::String(i) + ": pitch=" + juce::String(note.pitch) + 
-                             " active=" + juce::String(note.active ? 1 : 0) + 
-                             " velocity=" + juce::String(note.velocity));
+        logger->log(LogLevel::Debug, "Note " + juce::String(i) + ": pitch=" + juce::String(note.pitch) + 
+                                     " active=" + juce::String(note.active ? 1 : 0) + 
+                                     " velocity=" + juce::String(note.velocity));
     }
 }
 
@@ -376,7 +712,7 @@ void GrooveSequencerAudioProcessor::setTransformationType(TransformationType typ
     const juce::ScopedLock sl(patternLock);
     auto transformed = transformer.transformPattern(currentPattern, type);
     currentPattern = transformed;
-    patternModified = true;
+    commitPatternEdit();
 }
 
 void GrooveSequencerAudioProcessor::setRhythmPattern(RhythmPattern pattern)
@@ -392,22 +728,220 @@ void GrooveSequencerAudioProcessor::setArticulationStyle(ArticulationStyle style
 void GrooveSequencerAudioProcessor::generateNewPattern()
 {
     const juce::ScopedLock sl(patternLock);
-    auto pattern = transformer.generatePattern(transformationType, currentPattern.getNotes().size());
+    auto pattern = transformer.generatePattern(transformationType, static_cast<int>(currentPattern.getNoteCount()));
     currentPattern = pattern;
+    commitPatternEdit();
+}
+
+void GrooveSequencerAudioProcessor::regeneratePattern()
+{
+    const int length = juce::roundToInt(lengthParameter->load(std::memory_order_relaxed));
+    
+    const juce::ScopedLock sl(patternLock);
+    currentPattern = transformer.generatePattern(transformationType, length);
+    commitPatternEdit(true);
+    
+    logger->log(LogLevel::Info, "Pattern regenerated with length " + juce::String(length));
+}
+
+void GrooveSequencerAudioProcessor::commitPatternEdit(bool applyAtLoopBoundary)
+{
+    patternModified = true;
+    patternHistory.record(currentPattern);
+    publishPattern(applyAtLoopBoundary);
+}
+
+bool GrooveSequencerAudioProcessor::undoPatternEdit()
+{
+    const juce::ScopedLock sl(patternLock);
+    if (!patternHistory.undo(currentPattern))
+        return false;
+    
     patternModified = true;
+    publishPattern();
+    logger->log(LogLevel::Info, "Undo to history entry " + juce::String(patternHistory.getCurrentIndex()));
+    return true;
+}
+
+bool GrooveSequencerAudioProcessor::redoPatternEdit()
+{
+    const juce::ScopedLock sl(patternLock);
+    if (!patternHistory.redo(currentPattern))
+        return false;
+    
+    patternModified = true;
+    publishPattern();
+    logger->log(LogLevel::Info, "Redo to history entry " + juce::String(patternHistory.getCurrentIndex()));
+    return true;
+}
+
+bool GrooveSequencerAudioProcessor::jumpToPatternHistory(int index)
+{
+    const juce::ScopedLock sl(patternLock);
+    if (!patternHistory.jumpTo(index, currentPattern))
+        return false;
+    
+    patternModified = true;
+    publishPattern();
+    return true;
+}
+
+bool GrooveSequencerAudioProcessor::canUndoPatternEdit() const
+{
+    const juce::ScopedLock sl(patternLock);
+    return patternHistory.canUndo();
+}
+
+bool GrooveSequencerAudioProcessor::canRedoPatternEdit() const
+{
+    const juce::ScopedLock sl(patternLock);
+    return patternHistory.canRedo();
+}
+
+int GrooveSequencerAudioProcessor::getPatternHistorySize() const
+{
+    const juce::ScopedLock sl(patternLock);
+    return patternHistory.getNumEntries();
+}
+
+int GrooveSequencerAudioProcessor::getPatternHistoryIndex() const
+{
+    const juce::ScopedLock sl(patternLock);
+    return patternHistory.getCurrentIndex();
+}
+
+void GrooveSequencerAudioProcessor::setPatternHistoryMemoryLimit(size_t bytes)
+{
+    const juce::ScopedLock sl(patternLock);
+    patternHistory.setMemoryLimit(bytes);
+}
+
+void GrooveSequencerAudioProcessor::publishPattern(bool applyAtLoopBoundary)
+{
+    std::array<int, TrackConstants::NUM_TRACKS> droppedNotes{};
+    patternSnapshots.publish([this, &droppedNotes](CompiledTracks& compiled) {
+        for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+            droppedNotes[static_cast<size_t>(track)] = compiled.patterns[static_cast<size_t>(track)].compileFrom(getTrackPatternRef(track));
+        compiled.compileSettings(trackSettings);
+    }, applyAtLoopBoundary);
+    patternVersion.fetch_add(1, std::memory_order_release);
+    
+    // Only patterns that skipped Pattern::check() can get here with too many notes
+    for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+        if (const int dropped = droppedNotes[static_cast<size_t>(track)]; dropped > 0)
+            logger->log(LogLevel::Warning, "Track " + juce::String(track) + " has more than "
+                        + juce::String(CompiledPattern::kMaxNotes) + " notes; its last "
+                        + juce::String(dropped) + " will not play");
+}
+
+Pattern& GrooveSequencerAudioProcessor::getTrackPatternRef(int track)
+{
+    return track == TrackConstants::MAIN_TRACK ? currentPattern
+                                               : extraTrackPatterns[static_cast<size_t>(track - 1)];
+}
+
+void GrooveSequencerAudioProcessor::setTrackPattern(int track, const Pattern& pattern)
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return;
+    
+    const juce::ScopedLock sl(patternLock);
+    getTrackPatternRef(track) = pattern;
+    commitPatternEdit();
+    
+    logger->log(LogLevel::Info, "Track " + juce::String(track) + " set with " + juce::String(pattern.getNotes().size()) + " notes");
+}
+
+Pattern GrooveSequencerAudioProcessor::getTrackPattern(int track) const
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return {};
+    
+    const juce::ScopedLock sl(patternLock);
+    return track == TrackConstants::MAIN_TRACK ? currentPattern
+                                               : extraTrackPatterns[static_cast<size_t>(track - 1)];
+}
+
+void GrooveSequencerAudioProcessor::setTrackDivision(int track, NoteDivision newDivision)
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return;
+    
+    const juce::ScopedLock sl(patternLock);
+    trackSettings[static_cast<size_t>(track)].division = newDivision;
+    publishPattern();
+}
+
+void GrooveSequencerAudioProcessor::setTrackMidiChannel(int track, int channel)
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return;
+    
+    const juce::ScopedLock sl(patternLock);
+    trackSettings[static_cast<size_t>(track)].midiChannel = juce::jlimit(1, 16, channel);
+    publishPattern();
+}
+
+void GrooveSequencerAudioProcessor::setTrackMuted(int track, bool shouldMute)
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return;
+    
+    const juce::ScopedLock sl(patternLock);
+    trackSettings[static_cast<size_t>(track)].muted = shouldMute;
+    publishPattern();
+}
+
+void GrooveSequencerAudioProcessor::setTrackSoloed(int track, bool shouldSolo)
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return;
+    
+    const juce::ScopedLock sl(patternLock);
+    trackSettings[static_cast<size_t>(track)].soloed = shouldSolo;
+    publishPattern();
+}
+
+TrackSettings GrooveSequencerAudioProcessor::getTrackSettings(int track) const
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return {};
+    
+    const juce::ScopedLock sl(patternLock);
+    return trackSettings[static_cast<size_t>(track)];
+}
+
+int GrooveSequencerAudioProcessor::getSelectedTrack() const
+{
+    return juce::jlimit(0, TrackConstants::NUM_TRACKS - 1, juce::roundToInt(selectedTrackParameter->load()));
+}
+
+void GrooveSequencerAudioProcessor::setTrackEnabled(int track, bool shouldEnable)
+{
+    if (!juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS))
+        return;
+    
+    // The audio thread reads the parameter at the start of every block
+    state.getParameter(Parameters::getTrackEnabledId(track))->setValueNotifyingHost(shouldEnable ? 1.0f : 0.0f);
+}
+
+bool GrooveSequencerAudioProcessor::isTrackEnabled(int track) const
+{
+    return juce::isPositiveAndBelow(track, TrackConstants::NUM_TRACKS)
+           && trackEnabledParameters[static_cast<size_t>(track)]->load() >= 0.5f;
 }
 
 void GrooveSequencerAudioProcessor::transformCurrentPattern()
 {
     const juce::ScopedLock sl(patternLock);
     
-    fileLogger->logMessage("Transforming pattern with type: " + getTransformationTypeString(transformationType));
+    logger->log(LogLevel::Info, "Transforming pattern with type: " + getTransformationTypeString(transformationType));
     
     auto transformed = transformer.transformPattern(currentPattern, transformationType);
     currentPattern = transformed;
-    patternModified = true;
+    commitPatternEdit();
     
-    fileLogger->logMessage("Pattern transformed: " + juce::String(currentPattern.getNotes().size()) + " notes");
+    logger->log(LogLevel::Info, "Pattern transformed: " + juce::String(currentPattern.getNoteCount()) + " notes");
 }
 
 juce::String GrooveSequencerAudioProcessor::getTransformationTypeString(TransformationType type) const
@@ -437,11 +971,13 @@ void GrooveSequencerAudioProcessor::parameterChanged(const juce::String& paramet
 {
     if (parameterID == Parameters::TEMPO_ID)
     {
-        updatePlaybackPosition(0);
+        // The timing plan picks the new tempo up at the start of the next block
     }
     else if (parameterID == Parameters::GRID_SIZE_ID || parameterID == Parameters::LENGTH_ID)
     {
-        generateNewPattern();
+        // May be the audio thread under automation; the worker does the heavy lifting
+        if (regenerationWorker != nullptr && !restoringState.load(std::memory_order_relaxed))
+            regenerationWorker->request();
     }
     else if (parameterID == Parameters::SWING_ID || 
              parameterID == Parameters::VELOCITY_ID ||
@@ -459,46 +995,301 @@ void GrooveSequencerAudioProcessor::handleMidiInput(const juce::MidiMessage& mes
     if (message.isNoteOn())
     {
         const int noteNumber = message.getNoteNumber();
-        const float velocity = message.getFloatVelocity();
-        
-        const juce::ScopedLock sl(patternLock);
-        auto& notes = currentPattern.getNotes();
+        const float velocity = static_cast<float>(message.getVelocity());   // 0-127, as in Note
         
         // Ensure valid step index
-        if (currentStep >= static_cast<int>(notes.size()))
+        const auto& live = patternSnapshots.getLive();
+        if (currentStep >= live.getMainPattern().numSteps)
             return;
+        
+        // Pattern time is in beats of the main track, each kStepsPerBeat of its steps long:
+        // the note starts at its step's beat plus however far into the step it arrived.
+        // processBlock calls this with the sample clock at the message's own sample
+        const double samplesPerTrackBeat = (followingHost ? hostSamplesPerPpq : timingPlan.samplesPerBeat)
+                                           * live.ticksPerStep[TrackConstants::MAIN_TRACK];
+        const double beatsIntoStep = samplesPerTrackBeat > 0.0
+            ? static_cast<double>(sampleClock - mainStepStartClock) / samplesPerTrackBeat : 0.0;
             
-        // Create and initialize new note
-        Note newNote;
-        newNote.pitch = noteNumber;
-        newNote.velocity = velocity;
-        newNote.startTime = static_cast<float>(currentPosition);
-        newNote.duration = 1.0;  // Default duration
-        newNote.active = true;   // Ensure note is active
-        newNote.accent = 0;      // No accent by default
-        newNote.isStaccato = false;  // Not staccato by default
+        // Hand the note to the message thread; the audio thread never edits currentPattern
+        int start1, size1, start2, size2;
+        recordedNoteFifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0)
+        {
+            GS_RT_LOG(*logger, LogLevel::Warning, "Record queue full, dropping note={}", noteNumber);
+            return;
+        }
         
-        notes[static_cast<size_t>(currentStep)] = newNote;
-        patternModified = true;
+        // Create and initialize new note
+        auto& recorded = recordedNotes[static_cast<size_t>(start1)];
+        recorded.step = currentStep;
+        recorded.note = Note();
+        recorded.note.pitch = noteNumber;
+        recorded.note.velocity = velocity;
+        recorded.note.startTime = static_cast<float>(mainStepBeat + beatsIntoStep);
+        recorded.note.duration = 1.0f / CompiledPattern::kStepsPerBeat;  // One step
+        recorded.note.active = true;   // Ensure note is active
+        recorded.note.accent = 0;      // No accent by default
+        recorded.note.isStaccato = false;  // Not staccato by default
+        recordedNoteFifo.finishedWrite(1);
         
-        fileLogger->logMessage("MIDI input recorded: note=" + juce::String(noteNumber) + 
-                             " velocity=" + juce::String(velocity) + 
-                             " at step=" + juce::String(currentStep));
+        GS_RT_LOG(*logger, LogLevel::Debug, "MIDI input recorded: note={} velocity={} at step={}",
+                  noteNumber, velocity, currentStep);
+    }
+}
+
+namespace {
+    // Plugin state: magic and version, the parameter tree from writeToStream,
+    // then each track's settings and delta-encoded pattern. Sessions saved
+    // before this hold XML from copyXmlToBinary instead
+    constexpr char kStateMagic[4] = { 'G', 'S', 'S', 'T' };
+    // Version 2 appends the transport source after the tracks
+    constexpr juce::uint16 kStateVersion = 2;
+
+    constexpr juce::uint8 kMutedFlag = 1 << 0;
+    constexpr juce::uint8 kSoloedFlag = 1 << 1;
+
+    NoteDivision toDivision(juce::uint8 value) noexcept
+    {
+        switch (value)
+        {
+            case static_cast<int>(NoteDivision::Quarter): return NoteDivision::Quarter;
+            case static_cast<int>(NoteDivision::Eighth): return NoteDivision::Eighth;
+            default: return NoteDivision::Sixteenth;
+        }
+    }
+
+    TransportSource toTransportSource(juce::uint8 value) noexcept
+    {
+        return value == static_cast<int>(TransportSource::Host) ? TransportSource::Host
+                                                                 : TransportSource::Internal;
     }
 }
 
 void GrooveSequencerAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    auto treeState = state.copyState();
-    std::unique_ptr<juce::XmlElement> xml(treeState.createXml());
-    copyXmlToBinary(*xml, destData);
+    juce::MemoryOutputStream out(destData, false);
+    out.write(kStateMagic, sizeof(kStateMagic));
+    out.writeShort(static_cast<short>(kStateVersion));
+    out.writeShort(0);
+    
+    // Parameter tree, with its size filled in once written
+    const auto sizePosition = out.getPosition();
+    out.writeInt(0);
+    state.copyState().writeToStream(out);
+    const auto treeEnd = out.getPosition();
+    out.setPosition(sizePosition);
+    out.writeInt(static_cast<int>(treeEnd - sizePosition - 4));
+    out.setPosition(treeEnd);
+    
+    const juce::ScopedLock sl(patternLock);
+    out.writeByte(static_cast<char>(TrackConstants::NUM_TRACKS));
+    for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+    {
+        const auto& settings = trackSettings[static_cast<size_t>(track)];
+        out.writeByte(static_cast<char>(settings.division));
+        out.writeByte(static_cast<char>(settings.midiChannel));
+        out.writeByte(static_cast<char>((settings.muted ? kMutedFlag : 0) | (settings.soloed ? kSoloedFlag : 0)));
+        PatternDeltaCodec::write(getTrackPatternRef(track), out);
+    }
+    
+    out.writeByte(static_cast<char>(getTransportSource()));
 }
 
 void GrooveSequencerAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
-    if (xmlState.get() != nullptr)
-        state.replaceState(juce::ValueTree::fromXml(*xmlState));
+    PatternFormat::ByteReader reader(data, static_cast<size_t>(juce::jmax(0, sizeInBytes)));
+    const auto* magic = reader.read(sizeof(kStateMagic));
+    if (magic == nullptr || std::memcmp(magic, kStateMagic, sizeof(kStateMagic)) != 0)
+    {
+        std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+        if (xmlState.get() != nullptr)
+            state.replaceState(juce::ValueTree::fromXml(*xmlState));
+        return;
+    }
+    
+    juce::uint16 version = 0;
+    juce::uint32 treeSize = 0;
+    const juce::uint8* treeData = nullptr;
+    if (!reader.readUInt16(version) || !reader.skip(2) || !reader.readUInt32(treeSize)
+        || (treeData = reader.read(treeSize)) == nullptr)
+    {
+        logger->log(LogLevel::Error, "Plugin state is truncated");
+        return;
+    }
+    
+    if (version == 0 || version > kStateVersion)
+    {
+        logger->log(LogLevel::Error, "Unsupported plugin state version " + juce::String(version));
+        return;
+    }
+    
+    // Decode every track before applying anything, so damaged data leaves them alone
+    std::array<Pattern, TrackConstants::NUM_TRACKS> patterns;
+    std::array<TrackSettings, TrackConstants::NUM_TRACKS> settings{};
+    juce::uint8 numTracks = 0;
+    bool tracksRead = reader.readUInt8(numTracks);
+    
+    for (int track = 0; tracksRead && track < numTracks; ++track)
+    {
+        juce::uint8 division = 0, channel = 0, flags = 0;
+        Pattern pattern;
+        ValidationReport report;
+        tracksRead = reader.readUInt8(division) && reader.readUInt8(channel) && reader.readUInt8(flags)
+                     && PatternDeltaCodec::read(reader, pattern, report);
+        
+        if (!tracksRead)
+            logger->log(LogLevel::Error, "Invalid pattern for track " + juce::String(track) + " in plugin state: " + report.describe());
+        else if (track < TrackConstants::NUM_TRACKS)
+        {
+            auto& trackState = settings[static_cast<size_t>(track)];
+            trackState.division = toDivision(division);
+            trackState.midiChannel = juce::jlimit(1, 16, static_cast<int>(channel));
+            trackState.muted = (flags & kMutedFlag) != 0;
+            trackState.soloed = (flags & kSoloedFlag) != 0;
+            patterns[static_cast<size_t>(track)] = std::move(pattern);
+        }
+    }
+    
+    // States from before version 2 always ran on the internal clock
+    juce::uint8 transport = static_cast<juce::uint8>(TransportSource::Internal);
+    if (tracksRead && version >= 2 && !reader.readUInt8(transport))
+        logger->log(LogLevel::Warning, "Plugin state is missing its transport source");
+    
+    setTransportSource(toTransportSource(transport));
+    
+    auto tree = juce::ValueTree::readFromData(treeData, treeSize);
+    if (tree.isValid())
+    {
+        // Restored Length and Grid Size values must not regenerate over the restored pattern
+        restoringState.store(tracksRead, std::memory_order_relaxed);
+        state.replaceState(tree);
+        restoringState.store(false, std::memory_order_relaxed);
+    }
+    
+    if (!tracksRead)
+        return;
+    
+    const juce::ScopedLock sl(patternLock);
+    currentPattern = patterns[0];
+    for (size_t track = 1; track < patterns.size(); ++track)
+        extraTrackPatterns[track - 1] = patterns[track];
+    trackSettings = settings;
+    
+    patternHistory.reset(currentPattern);
+    publishPattern();
+}
+
+void GrooveSequencerAudioProcessor::savePattern(const juce::File& file)
+{
+    // A copy shares the notes, so this is cheap and later edits don't reach it
+    Pattern snapshot;
+    {
+        const juce::ScopedLock sl(patternLock);
+        snapshot = currentPattern;
+    }
+    
+    // Held to the same check as loading, so nothing is saved that could not be read back
+    const auto report = snapshot.check();
+    if (!report.isValid())
+    {
+        reportPatternFileError("Cannot save pattern to " + file.getFileName() + ": " + report.describe());
+        return;
+    }
+    
+    const auto target = file.getFileExtension().isEmpty() ? file.withFileExtension(PatternFormat::kFileExtension) : file;
+    patternFileThread->addJob([this, target, snapshot] { writePatternFile(target, snapshot); });
+}
+
+void GrooveSequencerAudioProcessor::loadPattern(const juce::File& file)
+{
+    patternFileThread->addJob([this, file] { readPatternFile(file); });
+}
+
+void GrooveSequencerAudioProcessor::writePatternFile(const juce::File& file, const Pattern& pattern)
+{
+    juce::MemoryOutputStream data;
+    try {
+        if (isJsonPatternFile(file))
+            data << juce::JSON::toString(pattern.toVar());
+        else
+            pattern.writeBinary(data);
+    }
+    catch (const std::exception& e) {
+        reportPatternFileError("Cannot save an invalid pattern: " + juce::String(e.what()));
+        return;
+    }
+    
+    // Written to a temporary file and moved over the target, so a failed save keeps the old file
+    if (!file.replaceWithData(data.getData(), data.getDataSize())) {
+        reportPatternFileError("Failed to write pattern file: " + file.getFullPathName());
+        return;
+    }
+    
+    logger->log(LogLevel::Info, "Pattern saved to " + file.getFullPathName());
+}
+
+void GrooveSequencerAudioProcessor::readPatternFile(const juce::File& file)
+{
+    if (!file.existsAsFile()) {
+        reportPatternFileError("Pattern file does not exist: " + file.getFullPathName());
+        return;
+    }
+    
+    Pattern pattern;
+    ValidationReport report;
+    const bool loaded = PatternFormat::readFileData(file, [&](const void* data, size_t size) {
+        if (!isJsonPatternFile(file))
+            return Pattern::tryFromBinary(data, size, pattern, report);
+        
+        // A browser entry or a bare pattern. A bare pattern has no entry metadata, so
+        // only that failure falls through; an entry whose pattern is damaged is refused
+        // with its own report, naming the bad notes
+        PatternEntry entry;
+        if (PatternJsonReader::readEntry(data, size, entry, report)) {
+            pattern = entry.pattern;
+            return true;
+        }
+        if (report.error != ValidationError::InvalidMetadata)
+            return false;
+        return PatternJsonReader::readPattern(data, size, pattern, report);
+    });
+    
+    if (!loaded) {
+        reportPatternFileError("Invalid pattern file " + file.getFileName() + ": " + report.describe());
+        return;
+    }
+    
+    // Only the swap holds the lock; the audio thread picks it up at the next loop boundary
+    const juce::ScopedLock sl(patternLock);
+    currentPattern = pattern;
+    commitPatternEdit(true);
+    
+    logger->log(LogLevel::Info, "Pattern loaded from " + file.getFullPathName() + " with "
+                                + juce::String(currentPattern.getNoteCount()) + " notes");
+}
+
+void GrooveSequencerAudioProcessor::reportPatternFileError(const juce::String& message)
+{
+    logger->log(LogLevel::Error, message);
+    
+    {
+        const juce::ScopedLock sl(fileErrorLock);
+        pendingFileErrors.add(message);
+    }
+    triggerAsyncUpdate();
+}
+
+void GrooveSequencerAudioProcessor::handleAsyncUpdate()
+{
+    juce::StringArray errors;
+    {
+        const juce::ScopedLock sl(fileErrorLock);
+        errors.swapWith(pendingFileErrors);
+    }
+    
+    if (onPatternFileError != nullptr)
+        for (const auto& message : errors)
+            onPatternFileError(message);
 }
 
 juce::AudioProcessorEditor* GrooveSequencerAudioProcessor::createEditor()
@@ -508,41 +1299,80 @@ juce::AudioProcessorEditor* GrooveSequencerAudioProcessor::createEditor()
 
 void GrooveSequencerAudioProcessor::setTempo(double newTempo)
 {
-    state.getParameter(Parameters::TEMPO_ID)->setValueNotifyingHost(newTempo / 300.0);
+    auto* parameter = state.getParameter(Parameters::TEMPO_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(newTempo)));
 }
 
 void GrooveSequencerAudioProcessor::setSwingAmount(double amount)
 {
-    swingAmount = juce::jlimit(0.0, 1.0, amount);
+    auto* parameter = state.getParameter(Parameters::SWING_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(amount)));
 }
 
 void GrooveSequencerAudioProcessor::setVelocityScale(double scale)
 {
-    velocityScale = juce::jlimit(0.0, 2.0, scale);
+    auto* parameter = state.getParameter(Parameters::VELOCITY_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(scale)));
 }
 
 void GrooveSequencerAudioProcessor::setGateLength(double length)
 {
-    gateLength = juce::jlimit(0.0, 1.0, length);
+    auto* parameter = state.getParameter(Parameters::GATE_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(length)));
 }
 
 void GrooveSequencerAudioProcessor::setLength(int newLength)
 {
-    state.getParameter(Parameters::LENGTH_ID)->setValueNotifyingHost(static_cast<float>(newLength));
-    generateNewPattern();
+    // The parameter listener schedules the regeneration
+    auto* parameter = state.getParameter(Parameters::LENGTH_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(newLength)));
+}
+
+void GrooveSequencerAudioProcessor::setOscillatorMode(OscillatorMode mode)
+{
+    auto* parameter = state.getParameter(Parameters::OSCILLATOR_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(mode)));
+}
+
+OscillatorMode GrooveSequencerAudioProcessor::getOscillatorMode() const
+{
+    return static_cast<OscillatorMode>(juce::roundToInt(oscillatorParameter->load()));
+}
+
+void GrooveSequencerAudioProcessor::setVoiceStealingPolicy(VoiceStealingPolicy policy)
+{
+    auto* parameter = state.getParameter(Parameters::VOICE_STEALING_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(policy)));
+}
+
+VoiceStealingPolicy GrooveSequencerAudioProcessor::getVoiceStealingPolicy() const
+{
+    return static_cast<VoiceStealingPolicy>(juce::roundToInt(voiceStealingParameter->load()));
+}
+
+void GrooveSequencerAudioProcessor::setPolyphony(int numVoices)
+{
+    auto* parameter = state.getParameter(Parameters::POLYPHONY_ID);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(numVoices)));
+}
+
+int GrooveSequencerAudioProcessor::getPolyphony() const
+{
+    return juce::roundToInt(polyphonyParameter->load());
 }
 
 void GrooveSequencerAudioProcessor::updateGridCell(int row, int col, bool active, float velocity, int accent, bool isStaccato)
 {
     const juce::ScopedLock sl(patternLock);
     
-    // Validate input parameters
-    if (row < 0 || col < 0 || velocity < 0.0f || velocity > 1.0f || accent < 0)
+    // Validate input parameters; velocity is MIDI-scaled like every Note's
+    if (row < 0 || col < 0 || velocity < PatternConstants::MIN_VELOCITY
+        || velocity > PatternConstants::MAX_VELOCITY || accent < 0)
     {
-        fileLogger->logMessage("Invalid grid cell parameters: row=" + juce::String(row) + 
-                             " col=" + juce::String(col) + 
-                             " velocity=" + juce::String(velocity) + 
-                             " accent=" + juce::String(accent));
+        logger->log(LogLevel::Warning, "Invalid grid cell parameters: row=" + juce::String(row) + 
+                                       " col=" + juce::String(col) + 
+                                       " velocity=" + juce::String(velocity) + 
+                                       " accent=" + juce::String(accent));
         return;
     }
         
@@ -550,7 +1380,7 @@ void GrooveSequencerAudioProcessor::updateGridCell(int row, int col, bool active
     const int gridSize = static_cast<int>(state.getParameter(Parameters::GRID_SIZE_ID)->getValue());
     if (col >= gridSize)  // Invalid column
     {
-        fileLogger->logMessage("Column " + juce::String(col) + " exceeds grid size " + juce::String(gridSize));
+        logger->log(LogLevel::Warning, "Column " + juce::String(col) + " exceeds grid size " + juce::String(gridSize));
         return;
     }
         
@@ -564,7 +1394,7 @@ void GrooveSequencerAudioProcessor::updateGridCell(int row, int col, bool active
         newNote.startTime = static_cast<float>(notes.size() * currentGridSize);
         newNote.duration = static_cast<float>(currentGridSize);
         newNote.active = false;     // Initialize as inactive
-        newNote.velocity = 0.8f;    // Default velocity
+        newNote.velocity = 100.0f;  // Default velocity
         newNote.accent = 0;         // No accent
         newNote.isStaccato = false; // Not staccato
         notes.push_back(newNote);
@@ -577,37 +1407,46 @@ void GrooveSequencerAudioProcessor::updateGridCell(int row, int col, bool active
     note.accent = accent;
     note.isStaccato = isStaccato;
     
-    patternModified = true;
+    commitPatternEdit();
     
-    fileLogger->logMessage("Updated grid cell: row=" + juce::String(row) + 
-                         " col=" + juce::String(col) + 
-                         " active=" + juce::String(active ? 1 : 0) + 
-                         " velocity=" + juce::String(velocity) + 
-                         " accent=" + juce::String(accent) + 
-                         " staccato=" + juce::String(isStaccato ? 1 : 0));
+    logger->log(LogLevel::Debug, "Updated grid cell: row=" + juce::String(row) + 
+                                 " col=" + juce::String(col) + 
+                                 " active=" + juce::String(active ? 1 : 0) + 
+                                 " velocity=" + juce::String(velocity) + 
+                                 " accent=" + juce::String(accent) + 
+                                 " staccato=" + juce::String(isStaccato ? 1 : 0));
 }
 
 double GrooveSequencerAudioProcessor::getTempo() const
 {
-    // Get the normalized value (0-1) and scale it to our tempo range (30-300)
-    return state.getParameter(Parameters::TEMPO_ID)->getValue() * 270.0 + 30.0;
+    return tempoParameter->load(std::memory_order_relaxed);
 }
 
 void GrooveSequencerAudioProcessor::timerCallback()
 {
-    // Update UI with current playback position
-    if (playing)
-    {
-        const double beatsPerMinute = getTempo();
-        const double beatsPerSecond = beatsPerMinute / 60.0;
-        const double samplesPerBeat = sampleRate / beatsPerSecond;
-        
-        // Calculate progress through current step
-        const double stepProgress = currentPosition / samplesPerBeat;
-        
-        fileLogger->logMessage("Playback progress: step=" + juce::String(currentStep) + 
-                             " progress=" + juce::String(stepProgress, 3));
-    }
+    // Apply notes recorded on the audio thread to the authoring pattern
+    const int numReady = recordedNoteFifo.getNumReady();
+    if (numReady == 0)
+        return;
+    
+    int start1, size1, start2, size2;
+    recordedNoteFifo.prepareToRead(numReady, start1, size1, start2, size2);
+    
+    const juce::ScopedLock sl(patternLock);
+    auto& notes = currentPattern.getNotes();
+    
+    auto applyRange = [&](int start, int size) {
+        for (int i = start; i < start + size; ++i) {
+            const auto& recorded = recordedNotes[static_cast<size_t>(i)];
+            if (recorded.step < static_cast<int>(notes.size()))
+                notes[static_cast<size_t>(recorded.step)] = recorded.note;
+        }
+    };
+    applyRange(start1, size1);
+    applyRange(start2, size2);
+    recordedNoteFifo.finishedRead(size1 + size2);
+    
+    commitPatternEdit();
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -3,6 +3,13 @@
 #include <JuceHeader.h>
 #include "Pattern.h"
 #include "PatternTransformer.h"
+#include "PatternSnapshot.h"
+#include "PatternHistory.h"
+#include "NoteOffScheduler.h"
+#include "TimingPlan.h"
+#include "RealtimeLogger.h"
+#include "CoalescingWorker.h"
+#include "VoiceBank.h"
 #include "Common.h"
 
 namespace Parameters
@@ -14,6 +21,13 @@ namespace Parameters
     static const juce::String SWING_ID = "swing";
     static const juce::String VELOCITY_ID = "velocity";
     static const juce::String GATE_ID = "gate";
+    static const juce::String OSCILLATOR_ID = "oscillator";
+    static const juce::String VOICE_STEALING_ID = "voiceStealing";
+    static const juce::String POLYPHONY_ID = "polyphony";
+    static const juce::String TRACK_ID = "track";      // Track addressed by the editor's track controls
+    
+    // One Enabled switch per track, "track1Enabled" to "track16Enabled"
+    inline juce::String getTrackEnabledId(int track) { return "track" + juce::String(track + 1) + "Enabled"; }
     
     // Parameter Defaults
     static constexpr float DEFAULT_TEMPO = 120.0f;
@@ -22,6 +36,9 @@ namespace Parameters
     static constexpr float DEFAULT_SWING = 0.0f;
     static constexpr float DEFAULT_VELOCITY = 1.0f;
     static constexpr float DEFAULT_GATE = 0.5f;
+    static constexpr int DEFAULT_OSCILLATOR = static_cast<int>(OscillatorMode::Polynomial);
+    static constexpr int DEFAULT_VOICE_STEALING = static_cast<int>(VoiceStealingPolicy::Oldest);
+    static constexpr int DEFAULT_POLYPHONY = VoiceBank::kDefaultNumVoices;
     
     // Create parameter layout
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
@@ -46,60 +63,46 @@ namespace Parameters
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
             GATE_ID, "Gate", 0.1f, 1.0f, DEFAULT_GATE));
             
+        // Choices follow the enum's order, so the index is the enum value
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            OSCILLATOR_ID, "Oscillator",
+            juce::StringArray{ juce::String(EnumToString::toString(OscillatorMode::Polynomial)),
+                               juce::String(EnumToString::toString(OscillatorMode::Wavetable)) },
+            DEFAULT_OSCILLATOR));
+            
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            VOICE_STEALING_ID, "Voice Stealing",
+            juce::StringArray{ juce::String(EnumToString::toString(VoiceStealingPolicy::Oldest)),
+                               juce::String(EnumToString::toString(VoiceStealingPolicy::Quietest)),
+                               juce::String(EnumToString::toString(VoiceStealingPolicy::SameNote)) },
+            DEFAULT_VOICE_STEALING));
+            
+        params.push_back(std::make_unique<juce::AudioParameterInt>(
+            POLYPHONY_ID, "Polyphony", 1, VoiceBank::kMaxVoices, DEFAULT_POLYPHONY));
+            
+        juce::StringArray trackNames;
+        for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+            trackNames.add("Track " + juce::String(track + 1));
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            TRACK_ID, "Track", trackNames, TrackConstants::MAIN_TRACK));
+            
+        for (int track = 0; track < TrackConstants::NUM_TRACKS; ++track)
+            params.push_back(std::make_unique<juce::AudioParameterBool>(
+                getTrackEnabledId(track), "Track " + juce::String(track + 1) + " Enabled", true));
+            
         return { params.begin(), params.end() };
     }
 }
 
-class SineVoice {
-public:
-    SineVoice() : currentFrequency(0.0f), phase(0.0f), amplitude(0.0f), sampleRate(44100.0f), isPlaying(false), currentNote(-1) {}
-    
-    void startNote(float frequency, float velocity) {
-        currentFrequency = frequency;
-        amplitude = velocity;
-        phase = 0.0f;
-        isPlaying = true;
-        currentNote = juce::MidiMessage::getMidiNoteInHertz(frequency);
-    }
-    
-    void stopNote() {
-        amplitude = 0.0f;
-        currentFrequency = 0.0f;
-        isPlaying = false;
-        currentNote = -1;
-    }
-    
-    float getNextSample() {
-        if (amplitude <= 0.0f) return 0.0f;
-        
-        float sample = std::sin(phase * 2.0f * juce::MathConstants<float>::pi) * amplitude;
-        phase += currentFrequency / sampleRate;
-        while (phase >= 1.0f) phase -= 1.0f;
-        
-        return sample;
-    }
-    
-    void setSampleRate(float newSampleRate) {
-        sampleRate = newSampleRate;
-    }
-
-    bool isActive() const { return isPlaying; }
-    float getCurrentNote() const { return currentNote; }
-    
-private:
-    float currentFrequency;
-    float phase;
-    float amplitude;
-    float sampleRate;
-    bool isPlaying;
-    float currentNote;
-};
-
 class GrooveSequencerAudioProcessor : public juce::AudioProcessor,
                                     public juce::AudioProcessorValueTreeState::Listener,
-                                    private juce::Timer
+                                    private juce::Timer,
+                                    private juce::AsyncUpdater
 {
 public:
+    // False for the GrooveSequencerMidi target, which renders no audio at all
+    static constexpr bool kHasInternalSynth = (JucePlugin_IsMidiEffect == 0);
+
     GrooveSequencerAudioProcessor();
     ~GrooveSequencerAudioProcessor() override;
 
@@ -117,7 +120,7 @@ public:
 
     bool acceptsMidi() const override { return true; }
     bool producesMidi() const override { return true; }
-    bool isMidiEffect() const override { return false; }
+    bool isMidiEffect() const override { return !kHasInternalSynth; }
     double getTailLengthSeconds() const override { return 0.0; }
 
     int getNumPrograms() override { return 1; }
@@ -129,20 +132,42 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
-    // Pattern management
+    // Pattern management; the grid edits the main track. getPattern() returns a
+    // copy taken under the pattern lock, so it is safe from any non-audio thread
     void setPattern(const Pattern& pattern);
-    Pattern& getPattern() { return currentPattern; }
-    const Pattern& getPattern() const { return currentPattern; }
+    Pattern getPattern() const { return getTrackPattern(TrackConstants::MAIN_TRACK); }
+    
+    // Bumped whenever the tracks are republished, so views know to reread them
+    juce::uint32 getPatternVersion() const { return patternVersion.load(std::memory_order_acquire); }
+    
+    // Tracks, indexed 0 to TrackConstants::NUM_TRACKS - 1; track 0 is the main pattern
+    void setTrackPattern(int track, const Pattern& pattern);
+    Pattern getTrackPattern(int track) const;
+    void setTrackDivision(int track, NoteDivision newDivision);
+    void setTrackMidiChannel(int track, int channel);
+    void setTrackMuted(int track, bool shouldMute);
+    void setTrackSoloed(int track, bool shouldSolo);
+    TrackSettings getTrackSettings(int track) const;
+    
+    // The editor's track selection and each track's Enabled parameter; a disabled
+    // track keeps its pattern and settings but stays silent
+    int getSelectedTrack() const;
+    void setTrackEnabled(int track, bool shouldEnable);
+    bool isTrackEnabled(int track) const;
     
     // Playback state
     void setLoopMode(bool shouldLoop) { loopMode = shouldLoop; }
     bool isLooping() const { return loopMode; }
     void setPlaying(bool shouldPlay) { 
         playing = shouldPlay; 
-        if (!playing) stopAllNotes();
+        if (!shouldPlay) stopAllNotes();
     }
     bool isPlaying() const { return playing; }
-    void resetPlayhead() { currentPosition = 0; }
+    void resetPlayhead() { currentStep = -1; }
+    
+    // Transport source, safe to change from any thread
+    void setTransportSource(TransportSource source) { transportSource.store(source, std::memory_order_relaxed); }
+    TransportSource getTransportSource() const { return transportSource.load(std::memory_order_relaxed); }
 
     // Parameter state
     juce::AudioProcessorValueTreeState& getState() { return state; }
@@ -157,11 +182,23 @@ public:
     void generateNewPattern();
     void transformCurrentPattern();
     
+    // Undo history of the main pattern; grid edits, transforms, generation and
+    // recording are recorded as they are committed
+    bool undoPatternEdit();
+    bool redoPatternEdit();
+    bool jumpToPatternHistory(int index);
+    bool canUndoPatternEdit() const;
+    bool canRedoPatternEdit() const;
+    int getPatternHistorySize() const;
+    int getPatternHistoryIndex() const;
+    void setPatternHistoryMemoryLimit(size_t bytes);
+    
     // Pattern state
     bool isPatternModified() const { return patternModified; }
     void clearModifiedFlag() { patternModified = false; }
 
-    // Playback control
+    // Playback control, safe from any thread; the audio thread ends the
+    // sounding notes at the start of its next block
     void startPlayback();
     void stopPlayback();
     void stopAllNotes();
@@ -173,12 +210,12 @@ public:
     void setVelocityScale(double scale);
     void setGateLength(double length);
     void setLength(int newLength);
-    int getLength() const { return static_cast<int>(currentPattern.getNotes().size()); }
+    int getLength() const { return static_cast<int>(getPattern().getNotes().size()); }
 
     void parameterChanged(const juce::String& parameterID, float newValue) override;
     void handleMidiInput(const juce::MidiMessage& message);
 
-    // Grid control
+    // Grid control; velocity is 0-127, as in Note
     void updateGridCell(int row, int col, bool active, float velocity, int accent, bool isStaccato);
     int getCurrentStep() const { return currentStep; }
     void setGridSize(double size) { currentGridSize = size; }
@@ -187,65 +224,193 @@ public:
     // Recording control
     bool isCurrentlyRecording() const;
 
-    // Pattern storage
+    // Pattern storage, run on a background thread. Files are binary unless the
+    // extension is .pattern or .json; a loaded pattern reaches the audio thread
+    // at the next loop boundary. Both directions reject a pattern that fails
+    // Pattern::check(), such as one with notes past its length
     void savePattern(const juce::File& file);
     void loadPattern(const juce::File& file);
+    
+    // Called on the message thread when a save or load fails
+    std::function<void(const juce::String& message)> onPatternFileError;
 
-    // Note division control
+    // Note division control for the main track
     void setNoteDivision(NoteDivision newDivision) { 
-        division = newDivision;
-        fileLogger->logMessage("Note division set to: " + EnumToString::toString(division));
+        setTrackDivision(TrackConstants::MAIN_TRACK, newDivision);
+        logger->log(LogLevel::Info, "Note division set to: " + juce::String(EnumToString::toString(newDivision)));
     }
-    NoteDivision getNoteDivision() const { return division; }
+    NoteDivision getNoteDivision() const { return getTrackSettings(TrackConstants::MAIN_TRACK).division; }
+
+    // Internal synth voices; the parameters reach the voice bank at the next block
+    void setOscillatorMode(OscillatorMode mode);
+    OscillatorMode getOscillatorMode() const;
+    void setVoiceStealingPolicy(VoiceStealingPolicy policy);
+    VoiceStealingPolicy getVoiceStealingPolicy() const;
+    void setPolyphony(int numVoices);
+    int getPolyphony() const;
 
 protected:
     void timerCallback() override;
+    void handleAsyncUpdate() override;
 
 private:
-    void updatePlaybackPosition(int numSamples);
-    void triggerNotesForCurrentStep();
-    void sendNoteEvents();
+    // Sub-block step scheduling
+    void renderVoices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void applySynthParameters();
+    bool refreshTimingPlan();
+    
+    // Internal clock: tick and track step positions on the sample clock
+    juce::int64 getCurrentTick() const;
+    juce::int64 getTickStartSample(juce::int64 tick) const;
+    juce::int64 getTrackStepStartSample(int track, juce::int64 step) const;
+    void startInternalTransport(int sampleOffset);
+    
+    // Host-locked transport: derives this block's steps from the host playhead
+    bool syncToHostPlayhead(int numSamples);
+    double getHostStepStartPpq(int track, juce::int64 step) const;
+    
+    // Track lanes: finds each clocked track's next event on its timeline, then fires the due ones
+    juce::uint32 readTrackEnabledMask() const;
+    juce::uint32 getAudibleTracks() const;
+    juce::uint32 getClockedTracks() const;
+    juce::int64 getTrackOrigin(int track) const;
+    juce::int64 getTrackPositionSample(int track, juce::int64 position) const;
+    void locateTracks();
+    void locateTrack(int track);
+    juce::int64 getNextTrackEventTime() const;
+    void fireDueTrackEvents(int sampleOffset);
+    bool advanceMainTrack(int sampleOffset);
+    void fireTrackEvent(int track, int sampleOffset);
+    void triggerTrackEvent(int track, int index, int sampleOffset);
+    
+    // Marks the pattern modified, records it in the undo history and publishes it (call with patternLock held)
+    void commitPatternEdit(bool applyAtLoopBoundary = false);
+    
+    // Compiles every track and hands them to the audio thread (call with patternLock held)
+    void publishPattern(bool applyAtLoopBoundary = false);
+    Pattern& getTrackPatternRef(int track);
+    
+    // Runs on the regeneration worker after Grid Size or Length changes
+    void regeneratePattern();
+    
+    // Run on the pattern file thread
+    void writePatternFile(const juce::File& file, const Pattern& pattern);
+    void readPatternFile(const juce::File& file);
+    void reportPatternFileError(const juce::String& message);
+    
+    // Sequencer note-offs, sent to the MIDI output and the synth (audio thread)
+    void sendSequencerNoteOff(int channel, int note, int sampleOffset);
+    void flushPendingNoteOffs(int sampleOffset);
+    void releaseAllVoices();
 
     juce::AudioProcessorValueTreeState state;
     Pattern currentPattern;
     PatternTransformer transformer;
     
     bool loopMode;
-    bool playing;
-    double currentPosition;
+    std::atomic<bool> playing;
+    std::atomic<bool> stopRequested{false};   // Set by stopAllNotes(), handled by processBlock
     double sampleRate;
-    double samplesPerBeat;
     int currentStep;
     double currentGridSize;
-    double swingAmount;
-    double velocityScale;
-    double gateLength;
     bool patternModified;
-    NoteDivision division;
     bool isRecording;
     
     TransformationType transformationType;
     RhythmPattern rhythmPattern;
     ArticulationStyle articulationStyle;
     
+    // Guards the authoring patterns and track settings between editing threads;
+    // never taken on the audio thread
     juce::CriticalSection patternLock;
+    std::atomic<juce::uint32> patternVersion{0};
+    PatternSnapshotBuffer patternSnapshots;
+    PatternHistory patternHistory;     // Of currentPattern only
+    
+    // Tracks other than the main one (currentPattern), empty until given a pattern
+    std::array<Pattern, TrackConstants::NUM_TRACKS - 1> extraTrackPatterns;
+    std::array<TrackSettings, TrackConstants::NUM_TRACKS> trackSettings{};
+    
+    // Notes recorded on the audio thread, applied to currentPattern by timerCallback
+    struct RecordedNote {
+        int step{0};
+        Note note;
+    };
+    static constexpr int kRecordFifoSize = 64;
+    juce::AbstractFifo recordedNoteFifo{kRecordFifoSize};
+    std::array<RecordedNote, kRecordFifoSize> recordedNotes;
+    
+    // Sequencer MIDI output, merged with the host's events and swapped into its buffer at the end of each block
+    static constexpr size_t kMidiOutputBufferBytes = 2048;
     juce::MidiBuffer midiBuffer;
+    juce::MidiBuffer spareMidiBuffer;   // Reserved storage swapped in when the host hands back a smaller one
     juce::AudioBuffer<float> floatBuffer;
 
     // Logger
-    std::unique_ptr<juce::FileLogger> fileLogger;
-
-    // Synth voices
-    static constexpr int kNumVoices = 16;
-    std::array<SineVoice, kNumVoices> voices;
-    
-    // Find a free voice or steal the oldest one
-    SineVoice* findFreeVoice() {
-        for (auto& voice : voices) {
-            if (!voice.isActive()) return &voice;
-        }
-        return &voices[0]; // If no free voice, steal the first one
-    }
+    std::unique_ptr<RealtimeLogger> logger;
+
+    // Synth voices, unused when built as a MIDI effect
+    VoiceBank voiceBank;
+    
+    // Raw parameter values, looked up once so the audio thread never searches by ID
+    std::atomic<float>* tempoParameter{nullptr};
+    std::atomic<float>* swingParameter{nullptr};
+    std::atomic<float>* velocityParameter{nullptr};
+    std::atomic<float>* gateParameter{nullptr};
+    std::atomic<float>* lengthParameter{nullptr};
+    std::atomic<float>* oscillatorParameter{nullptr};
+    std::atomic<float>* voiceStealingParameter{nullptr};
+    std::atomic<float>* polyphonyParameter{nullptr};
+    std::atomic<float>* selectedTrackParameter{nullptr};
+    std::array<std::atomic<float>*, TrackConstants::NUM_TRACKS> trackEnabledParameters{};
+    
+    // Step timing, rebuilt on the audio thread only when one of its inputs changes
+    TimingPlan timingPlan;
+    
+    // Internal clock, on the sample clock. Tick T starts at
+    // gridAnchorSample + floor((T - gridAnchorTick) * num / den) from the timing plan,
+    // so it lands on the same sample however long the transport runs; the anchor is
+    // set when playback starts and only moves when the tick length changes
+    juce::int64 gridAnchorTick{0};
+    juce::int64 gridAnchorSample{0};
+    
+    // Host playhead state for the current block; every track's next step is
+    // recomputed from ppqPosition each block, the rest only detects jumps
+    std::atomic<TransportSource> transportSource{TransportSource::Internal};
+    bool followingHost{false};
+    double hostBlockStartPpq{0.0};
+    double hostSamplesPerPpq{0.0};
+    double expectedHostPpq{0.0};
+    juce::int64 hostBlockStartClock{0};
+    
+    // Track lanes in structure-of-arrays form, indexed by track. Events are
+    // numbered across loops of the track's timeline and times are on the sample
+    // clock; the last fired position, in 1/kUnitsPerStep ticks so it survives a
+    // division change, keeps a re-located track from repeating an event
+    std::array<juce::int64, TrackConstants::NUM_TRACKS> trackNextEvent{};
+    std::array<juce::int64, TrackConstants::NUM_TRACKS> trackNextEventTime{};
+    std::array<juce::int64, TrackConstants::NUM_TRACKS> trackLastSubtick{};
+    juce::uint32 trackEnabledMask{~juce::uint32{0}};   // Track Enabled parameters as of this block
+    juce::int64 mainOriginSubtick{0};   // Where the main track's pattern last started, so a swapped-in one starts at its top
+    juce::int64 mainStepStartClock{0};
+    double mainStepBeat{0.0};   // Where the current main step sits in the pattern, in beats
+    
+    // Gate ends of sequencer notes, against a sample clock that never wraps or resets
+    NoteOffScheduler pendingNoteOffs;
+    juce::int64 sampleClock{0};
+
+    // Set while setStateInformation replaces the parameters of a state that
+    // carries its own patterns, so their listeners don't regenerate
+    std::atomic<bool> restoringState{false};
+
+    // Coalesces parameter-driven regeneration off the listener's thread; declared
+    // last so it stops before anything its job touches is destroyed
+    std::unique_ptr<CoalescingWorker> regenerationWorker;
+    
+    // Saves and loads patterns in request order; failures are queued for handleAsyncUpdate
+    std::unique_ptr<juce::ThreadPool> patternFileThread;
+    juce::CriticalSection fileErrorLock;
+    juce::StringArray pendingFileErrors;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrooveSequencerAudioProcessor)
 };
\ No newline at end of file
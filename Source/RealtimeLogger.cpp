@@ -0,0 +1,102 @@
+#include "RealtimeLogger.h"
+
+RealtimeLogger::RealtimeLogger(const juce::File& logFile, const juce::String& welcomeMessage)
+    : juce::Thread("GrooveSequencer Logger")
+{
+    // Create directory if it doesn't exist
+    if (!logFile.getParentDirectory().exists())
+        logFile.getParentDirectory().createDirectory();
+
+    fileLogger = std::make_unique<juce::FileLogger>(logFile, welcomeMessage);
+
+#if JUCE_DEBUG
+    setMinimumLevel(LogLevel::Debug);
+#endif
+
+    startThread();
+}
+
+RealtimeLogger::~RealtimeLogger()
+{
+    stopThread(1000);
+    flushQueuedRecords();
+}
+
+void RealtimeLogger::log(LogLevel level, const juce::String& message)
+{
+    if (!isEnabled(level))
+        return;
+
+    fileLogger->logMessage(getLevelPrefix(level) + message);
+}
+
+void RealtimeLogger::run()
+{
+    while (!threadShouldExit())
+    {
+        flushQueuedRecords();
+        wait(kFlushIntervalMs);
+    }
+}
+
+void RealtimeLogger::flushQueuedRecords()
+{
+    const int numReady = fifo.getNumReady();
+    const int numDropped = droppedRecords.exchange(0, std::memory_order_relaxed);
+
+    if (numReady == 0 && numDropped == 0)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    // Format the whole batch and write it with a single file append
+    juce::StringArray lines;
+    for (int i = start1; i < start1 + size1; ++i)
+        lines.add(formatRecord(records[static_cast<size_t>(i)]));
+    for (int i = start2; i < start2 + size2; ++i)
+        lines.add(formatRecord(records[static_cast<size_t>(i)]));
+
+    fifo.finishedRead(size1 + size2);
+
+    if (numDropped > 0)
+        lines.add(getLevelPrefix(LogLevel::Warning) + "Log queue overflow, dropped " + juce::String(numDropped) + " records");
+
+    fileLogger->logMessage(lines.joinIntoString(juce::newLine));
+}
+
+juce::String RealtimeLogger::formatRecord(const Record& record)
+{
+    juce::String result = getLevelPrefix(record.level);
+    int argIndex = 0;
+
+    for (auto* p = record.format; p != nullptr && *p != 0; ++p)
+    {
+        if (p[0] == '{' && p[1] == '}' && argIndex < record.numArgs)
+        {
+            const double value = record.args[static_cast<size_t>(argIndex++)];
+            if (value == std::floor(value) && std::abs(value) < 1.0e15)
+                result << juce::String(static_cast<juce::int64>(value));
+            else
+                result << juce::String(value, 3);
+            ++p;
+        }
+        else
+        {
+            result << juce::String::charToString(static_cast<juce::juce_wchar>(*p));
+        }
+    }
+
+    return result;
+}
+
+juce::String RealtimeLogger::getLevelPrefix(LogLevel level)
+{
+    switch (level) {
+        case LogLevel::Debug: return "[DEBUG] ";
+        case LogLevel::Info: return "[INFO] ";
+        case LogLevel::Warning: return "[WARN] ";
+        case LogLevel::Error: return "[ERROR] ";
+        default: return "[UNKNOWN] ";
+    }
+}
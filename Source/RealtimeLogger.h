@@ -0,0 +1,107 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Common.h"
+#include <array>
+#include <atomic>
+
+// Levels below this are compiled out of GS_RT_LOG call sites entirely
+// (0 = Debug, 1 = Info, 2 = Warning, 3 = Error)
+#ifndef GROOVE_SEQUENCER_MIN_LOG_LEVEL
+ #if JUCE_DEBUG
+  #define GROOVE_SEQUENCER_MIN_LOG_LEVEL 0
+ #else
+  #define GROOVE_SEQUENCER_MIN_LOG_LEVEL 1
+ #endif
+#endif
+
+/**
+ * @brief File logger that is safe to call from the audio thread
+ *
+ * The audio thread posts fixed-size binary records into a preallocated
+ * single-producer/single-consumer ring. A background thread formats them
+ * and flushes them to the log file in batches. Other threads log through
+ * log(), which formats on the calling thread and writes directly.
+ */
+class RealtimeLogger : private juce::Thread {
+public:
+    static constexpr int kMaxArgs = 4;
+    static constexpr int kQueueSize = 1024;
+    static constexpr int kFlushIntervalMs = 100;
+
+    struct Record {
+        const char* format{nullptr};  // String literal, "{}" marks each argument
+        std::array<double, kMaxArgs> args{};
+        int numArgs{0};
+        LogLevel level{LogLevel::Info};
+    };
+
+    RealtimeLogger(const juce::File& logFile, const juce::String& welcomeMessage);
+    ~RealtimeLogger() override;
+
+    // Level gating
+    static constexpr bool isCompiledIn(LogLevel level) noexcept {
+        return static_cast<int>(level) >= GROOVE_SEQUENCER_MIN_LOG_LEVEL;
+    }
+    [[nodiscard]] bool isEnabled(LogLevel level) const noexcept {
+        return static_cast<int>(level) >= minimumLevel.load(std::memory_order_relaxed);
+    }
+    void setMinimumLevel(LogLevel level) noexcept {
+        minimumLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Queues a record from the audio thread without allocating or formatting
+     *
+     * The record is dropped if the ring is full. Only one thread may post.
+     */
+    template <typename... Args>
+    void post(LogLevel level, const char* format, Args... args) noexcept {
+        static_assert(sizeof...(Args) <= kMaxArgs, "Too many log arguments");
+
+        if (!isEnabled(level))
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0) {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto& record = records[static_cast<size_t>(start1)];
+        record.format = format;
+        record.level = level;
+        record.numArgs = static_cast<int>(sizeof...(Args));
+        int index = 0;
+        ((record.args[static_cast<size_t>(index++)] = static_cast<double>(args)), ...);
+        fifo.finishedWrite(1);
+    }
+
+    // Logs from a non-realtime thread
+    void log(LogLevel level, const juce::String& message);
+
+    // The underlying file logger, also installed as juce::Logger's current logger
+    [[nodiscard]] juce::FileLogger& getFileLogger() noexcept { return *fileLogger; }
+
+private:
+    void run() override;
+    void flushQueuedRecords();
+    static juce::String formatRecord(const Record& record);
+    static juce::String getLevelPrefix(LogLevel level);
+
+    std::unique_ptr<juce::FileLogger> fileLogger;
+    juce::AbstractFifo fifo{kQueueSize};
+    std::array<Record, kQueueSize> records;
+    std::atomic<int> minimumLevel{static_cast<int>(LogLevel::Info)};
+    std::atomic<int> droppedRecords{0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimeLogger)
+};
+
+// Audio-thread logging; disabled levels cost nothing at the call site
+#define GS_RT_LOG(logger, level, ...) \
+    do { \
+        if constexpr (RealtimeLogger::isCompiledIn(level)) \
+            (logger).post(level, __VA_ARGS__); \
+    } while (false)
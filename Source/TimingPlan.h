@@ -0,0 +1,88 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Common.h"
+#include <numeric>
+
+/**
+ * @brief Step timing derived from tempo, swing, gate and sample rate
+ *
+ * Rebuilt on the audio thread only when one of its inputs changes, so the
+ * step scheduler reads plain fields instead of re-deriving them per step.
+ *
+ * Timing is laid out on a grid of sixteenth-note ticks shared by every
+ * track; a track's division only sets how many ticks make one of its steps.
+ * Tick lengths are kept as an exact fraction of samples so the internal
+ * clock can place any step without accumulating rounding.
+ */
+struct TimingPlan {
+    static constexpr int kTicksPerBeat = 4;
+
+    struct Inputs {
+        double sampleRate{0.0};
+        float tempo{0.0f};           // BPM
+        float swing{0.0f};           // 0-1, fraction of half a step
+        float gate{0.0f};            // Fraction of the note's duration
+
+        bool operator==(const Inputs& other) const noexcept {
+            return sampleRate == other.sampleRate && tempo == other.tempo
+                && swing == other.swing && gate == other.gate;
+        }
+        bool operator!=(const Inputs& other) const noexcept { return !(*this == other); }
+    };
+
+    Inputs inputs;
+
+    // Samples per tick as tickNumerator / tickDenominator, with the tempo
+    // quantised to 0.001 BPM and the sample rate to whole hertz
+    juce::int64 tickNumerator{0};
+    juce::int64 tickDenominator{1};
+    juce::int64 swingPermille{0};
+
+    double samplesPerBeat{0.0};
+
+    double tickLengthPpq{1.0 / kTicksPerBeat};
+    double swingOffsetPpq{0.0};      // Per tick of step length
+
+    double gateSamplesPerBeat{0.0};
+    double staccatoGateSamplesPerBeat{0.0};
+
+    static constexpr int getTicksPerStep(NoteDivision division) noexcept {
+        return juce::jmax(1, kTicksPerBeat * 4 / static_cast<int>(division));
+    }
+
+    // Delay applied to the odd steps of a track whose steps are ticksPerStep long
+    [[nodiscard]] juce::int64 getSwingOffsetSamples(int ticksPerStep) const noexcept {
+        return swingPermille * tickNumerator * ticksPerStep / (2000 * tickDenominator);
+    }
+
+    [[nodiscard]] bool hasSameGrid(const TimingPlan& other) const noexcept {
+        return tickNumerator == other.tickNumerator && tickDenominator == other.tickDenominator;
+    }
+
+    static TimingPlan build(const Inputs& newInputs) noexcept {
+        TimingPlan plan;
+        plan.inputs = newInputs;
+
+        const auto sampleRateHz = juce::jmax(juce::int64{1}, static_cast<juce::int64>(std::llround(newInputs.sampleRate)));
+        const auto milliBpm = juce::jmax(juce::int64{1}, static_cast<juce::int64>(std::llround(newInputs.tempo * 1000.0)));
+
+        // rate * 60 / (bpm * ticksPerBeat)
+        const juce::int64 numerator = sampleRateHz * 60 * 1000;
+        const juce::int64 denominator = milliBpm * kTicksPerBeat;
+        const auto divisor = std::gcd(numerator, denominator);
+        plan.tickNumerator = numerator / divisor;
+        plan.tickDenominator = denominator / divisor;
+
+        const double swing = juce::jlimit(0.0, 1.0, static_cast<double>(newInputs.swing));
+        plan.swingPermille = std::llround(swing * 1000.0);
+
+        plan.samplesPerBeat = static_cast<double>(sampleRateHz) * 60000.0 / static_cast<double>(milliBpm);
+        plan.swingOffsetPpq = swing * plan.tickLengthPpq * 0.5;
+
+        const double gate = juce::jlimit(0.0, 1.0, static_cast<double>(newInputs.gate));
+        plan.gateSamplesPerBeat = plan.samplesPerBeat * gate;
+        plan.staccatoGateSamplesPerBeat = plan.gateSamplesPerBeat * 0.5;
+        return plan;
+    }
+};
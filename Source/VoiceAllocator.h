@@ -0,0 +1,198 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Common.h"
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Constant-time voice allocation for the internal synth
+ *
+ * Free voices live on an intrusive stack, sounding voices on an age-ordered
+ * doubly linked list, and each note maps to the newest voice playing it
+ * (older voices for the same note are chained behind it). Notes are keyed by
+ * source as well as pitch, so one source's note-off never ends a voice that
+ * another source started on the same pitch. Note-on and
+ * note-off never scan the voice pool; only the Quietest stealing policy
+ * walks the sounding voices, and only when the pool is exhausted.
+ *
+ * Not thread-safe: use from the audio thread only, apart from
+ * setStealingPolicy which may be called from anywhere.
+ */
+class VoiceAllocator {
+public:
+    static constexpr int kMaxVoices = 256;
+    static constexpr int kNumMidiNotes = 128;
+    static constexpr int kNumMidiChannels = 16;
+    static constexpr int kNoVoice = -1;
+
+    // Live MIDI input channels come first, then the sequencer's output channels
+    static constexpr int kNumSources = 2 * kNumMidiChannels;
+    static int getLiveSource(int midiChannel) noexcept { return juce::jlimit(1, kNumMidiChannels, midiChannel) - 1; }
+    static int getSequencerSource(int midiChannel) noexcept { return kNumMidiChannels + getLiveSource(midiChannel); }
+
+    struct Allocation {
+        int voice{kNoVoice};
+        int stolenNote{-1};   // Note that was cut off to free the voice, or -1
+    };
+
+    explicit VoiceAllocator(int numVoices = 16) { setNumVoices(numVoices); }
+
+    // Resizes the pool and releases every voice; not for use while rendering
+    void setNumVoices(int newNumVoices) noexcept {
+        numVoices = juce::jlimit(1, kMaxVoices, newNumVoices);
+        reset();
+    }
+    [[nodiscard]] int getNumVoices() const noexcept { return numVoices; }
+
+    void setStealingPolicy(VoiceStealingPolicy policy) noexcept { stealingPolicy.store(policy, std::memory_order_relaxed); }
+    [[nodiscard]] VoiceStealingPolicy getStealingPolicy() const noexcept { return stealingPolicy.load(std::memory_order_relaxed); }
+
+    void reset() noexcept {
+        noteToVoice.fill(kNoVoice);
+        oldestVoice = newestVoice = kNoVoice;
+        freeHead = kNoVoice;
+
+        for (int v = numVoices - 1; v >= 0; --v) {
+            auto& slot = slots[static_cast<size_t>(v)];
+            slot = VoiceSlot{};
+            slot.nextFree = freeHead;
+            freeHead = v;
+        }
+    }
+
+    /**
+     * @brief Assigns a voice to a note, stealing one if the pool is full
+     * @param source Where the note came from (0 to kNumSources - 1)
+     * @param note MIDI note number (0-127)
+     * @param level Voice level, used by the Quietest policy
+     */
+    Allocation noteOn(int source, int note, float level) noexcept {
+        const int key = getKey(juce::jlimit(0, kNumSources - 1, source), juce::jlimit(0, kNumMidiNotes - 1, note));
+        const auto policy = getStealingPolicy();
+        Allocation result;
+
+        // Retrigger rather than stack when the policy asks for it
+        if (policy == VoiceStealingPolicy::SameNote && noteToVoice[static_cast<size_t>(key)] != kNoVoice) {
+            result.voice = noteToVoice[static_cast<size_t>(key)];
+            result.stolenNote = key % kNumMidiNotes;
+            release(result.voice);
+        }
+        else if (freeHead != kNoVoice) {
+            result.voice = freeHead;
+            freeHead = slots[static_cast<size_t>(freeHead)].nextFree;
+        }
+        else {
+            result.voice = policy == VoiceStealingPolicy::Quietest ? findQuietestVoice() : oldestVoice;
+            result.stolenNote = slots[static_cast<size_t>(result.voice)].key % kNumMidiNotes;
+            release(result.voice);
+        }
+
+        // release() pushes the voice onto the free stack; take it straight back off
+        if (result.voice == freeHead)
+            freeHead = slots[static_cast<size_t>(result.voice)].nextFree;
+
+        auto& slot = slots[static_cast<size_t>(result.voice)];
+        slot.key = key;
+        slot.level = level;
+        slot.sounding = true;
+
+        // Newest voice for this note goes in front of any older ones
+        slot.nextSameNote = noteToVoice[static_cast<size_t>(key)];
+        noteToVoice[static_cast<size_t>(key)] = result.voice;
+
+        // Append to the age list as the newest voice
+        slot.older = newestVoice;
+        slot.newer = kNoVoice;
+        if (newestVoice != kNoVoice)
+            slots[static_cast<size_t>(newestVoice)].newer = result.voice;
+        newestVoice = result.voice;
+        if (oldestVoice == kNoVoice)
+            oldestVoice = result.voice;
+
+        return result;
+    }
+
+    /**
+     * @brief Releases every voice a source is playing a note on
+     * @param onRelease Called with the index of each released voice
+     */
+    template <typename Callback>
+    void noteOff(int source, int note, Callback&& onRelease) noexcept {
+        if (!isValid(source, note))
+            return;
+
+        int voice = noteToVoice[static_cast<size_t>(getKey(source, note))];
+        while (voice != kNoVoice) {
+            const int next = slots[static_cast<size_t>(voice)].nextSameNote;
+            release(voice);
+            onRelease(voice);
+            voice = next;
+        }
+    }
+
+    [[nodiscard]] int getVoiceForNote(int source, int note) const noexcept {
+        return isValid(source, note) ? noteToVoice[static_cast<size_t>(getKey(source, note))] : kNoVoice;
+    }
+
+    [[nodiscard]] bool isSounding(int voice) const noexcept {
+        return slots[static_cast<size_t>(voice)].sounding;
+    }
+
+private:
+    struct VoiceSlot {
+        int key{-1};   // Source and note, from getKey()
+        float level{0.0f};
+        bool sounding{false};
+        int nextFree{kNoVoice};
+        int older{kNoVoice};
+        int newer{kNoVoice};
+        int nextSameNote{kNoVoice};
+    };
+
+    // Unlinks a sounding voice from the age list and its note chain, and frees it
+    void release(int voice) noexcept {
+        auto& slot = slots[static_cast<size_t>(voice)];
+        if (!slot.sounding)
+            return;
+
+        if (slot.older != kNoVoice) slots[static_cast<size_t>(slot.older)].newer = slot.newer;
+        else oldestVoice = slot.newer;
+        if (slot.newer != kNoVoice) slots[static_cast<size_t>(slot.newer)].older = slot.older;
+        else newestVoice = slot.older;
+
+        // Note chains are short (one voice per stacked retrigger), so this walk is bounded
+        auto* link = &noteToVoice[static_cast<size_t>(slot.key)];
+        while (*link != kNoVoice && *link != voice)
+            link = &slots[static_cast<size_t>(*link)].nextSameNote;
+        if (*link == voice)
+            *link = slot.nextSameNote;
+
+        slot = VoiceSlot{};
+        slot.nextFree = freeHead;
+        freeHead = voice;
+    }
+
+    static int getKey(int source, int note) noexcept { return source * kNumMidiNotes + note; }
+    static bool isValid(int source, int note) noexcept {
+        return source >= 0 && source < kNumSources && note >= 0 && note < kNumMidiNotes;
+    }
+
+    [[nodiscard]] int findQuietestVoice() const noexcept {
+        int quietest = oldestVoice;
+        for (int v = oldestVoice; v != kNoVoice; v = slots[static_cast<size_t>(v)].newer)
+            if (slots[static_cast<size_t>(v)].level < slots[static_cast<size_t>(quietest)].level)
+                quietest = v;
+        return quietest;
+    }
+
+    std::array<VoiceSlot, kMaxVoices> slots{};
+    std::array<int, kNumSources * kNumMidiNotes> noteToVoice{};
+    int numVoices{0};
+    int freeHead{kNoVoice};
+    int oldestVoice{kNoVoice};
+    int newestVoice{kNoVoice};
+    std::atomic<VoiceStealingPolicy> stealingPolicy{VoiceStealingPolicy::Oldest};
+
+    JUCE_DECLARE_NON_COPYABLE(VoiceAllocator)
+};
@@ -0,0 +1,193 @@
+#include "VoiceBank.h"
+
+namespace {
+    constexpr double kDefaultSampleRate = 44100.0;
+    constexpr int kDefaultBlockSize = 512;
+
+    // Weight of the second parabola pass in the sine approximation
+    constexpr float kSinePrecision = 0.225f;
+
+    using BitUtils::countTrailingZeros;
+}
+
+VoiceBank::VoiceBank()
+{
+    // A single sine partial, so the table is band-limited at every pitch
+    for (int i = 0; i <= kWavetableSize; ++i)
+    {
+        const double phase = static_cast<double>(i) / kWavetableSize - 0.5;
+        wavetable[static_cast<size_t>(i)] = static_cast<float>(std::sin(phase * juce::MathConstants<double>::twoPi));
+    }
+
+    prepare(kDefaultSampleRate, kDefaultBlockSize);
+    notes.fill(-1);
+}
+
+void VoiceBank::prepare(double newSampleRate, int maxBlockSize)
+{
+    if (static_cast<float>(newSampleRate) != sampleRate)
+    {
+        sampleRate = static_cast<float>(newSampleRate);
+        updatePhaseIncrements();
+    }
+
+    const int blockSize = juce::jmax(1, maxBlockSize);
+    if (blockSize > scratchSize)
+    {
+        // Over-allocate so the scratch pointer can be aligned for SIMD loads
+        scratchStorage.allocate(static_cast<size_t>(blockSize) + SIMDFloat::SIMDNumElements, true);
+        scratch = SIMDFloat::getNextSIMDAlignedPtr(scratchStorage.get());
+        scratchSize = blockSize;
+    }
+}
+
+void VoiceBank::updatePhaseIncrements() noexcept
+{
+    for (int note = 0; note < kNumMidiNotes; ++note)
+    {
+        const double frequency = juce::MidiMessage::getMidiNoteInHertz(note);
+        phaseIncrements[static_cast<size_t>(note)] = static_cast<float>(frequency / sampleRate);
+    }
+}
+
+void VoiceBank::startVoice(int index, int midiNote, float velocity) noexcept
+{
+    const auto i = static_cast<size_t>(index);
+    const int note = juce::jlimit(0, kNumMidiNotes - 1, midiNote);
+    increments[i] = phaseIncrements[static_cast<size_t>(note)];
+    amplitudes[i] = velocity;
+    phases[i] = 0.0f;
+    notes[i] = note;
+    activeMask[i / 64] |= juce::uint64{1} << (i % 64);
+}
+
+void VoiceBank::stopVoice(int index) noexcept
+{
+    const auto i = static_cast<size_t>(index);
+    amplitudes[i] = 0.0f;
+    increments[i] = 0.0f;
+    notes[i] = -1;
+    activeMask[i / 64] &= ~(juce::uint64{1} << (i % 64));
+}
+
+void VoiceBank::setNumVoices(int newNumVoices) noexcept
+{
+    stopAll();
+    allocator.setNumVoices(newNumVoices);
+}
+
+int VoiceBank::noteOn(int source, int midiNote, float velocity) noexcept
+{
+    const auto allocation = allocator.noteOn(source, midiNote, velocity);
+    startVoice(allocation.voice, midiNote, velocity);
+    return allocation.voice;
+}
+
+void VoiceBank::noteOff(int source, int midiNote) noexcept
+{
+    allocator.noteOff(source, midiNote, [this](int voice) { stopVoice(voice); });
+}
+
+void VoiceBank::stopAll() noexcept
+{
+    for (size_t word = 0; word < activeMask.size(); ++word)
+        for (auto bits = activeMask[word]; bits != 0; bits &= bits - 1)
+            stopVoice(static_cast<int>(word * 64) + countTrailingZeros(bits));
+
+    allocator.reset();
+}
+
+bool VoiceBank::hasActiveVoices() const noexcept
+{
+    for (const auto word : activeMask)
+        if (word != 0)
+            return true;
+
+    return false;
+}
+
+void VoiceBank::renderBlock(float* output, int numSamples) noexcept
+{
+    const bool useWavetable = getOscillatorMode() == OscillatorMode::Wavetable;
+
+    // Hosts may exceed the block size given to prepare, so render in scratch-sized chunks
+    for (int offset = 0; offset < numSamples; offset += scratchSize)
+    {
+        const int chunkSize = juce::jmin(scratchSize, numSamples - offset);
+
+        // Visit only the set bits of the active mask
+        for (size_t word = 0; word < activeMask.size(); ++word)
+            for (auto bits = activeMask[word]; bits != 0; bits &= bits - 1)
+                renderVoice(word * 64 + static_cast<size_t>(countTrailingZeros(bits)),
+                            output + offset, chunkSize, useWavetable);
+    }
+}
+
+void VoiceBank::renderVoice(size_t v, float* output, int numSamples, bool useWavetable) noexcept
+{
+    if (amplitudes[v] <= 0.0f)
+        return;
+
+    // Phase ramp for the whole chunk
+    float phase = phases[v];
+    const float increment = increments[v];
+    for (int i = 0; i < numSamples; ++i)
+    {
+        scratch[i] = phase;
+        phase += increment;
+        if (phase >= 0.5f)
+            phase -= 1.0f;
+    }
+    phases[v] = phase;
+
+    if (useWavetable)
+        wavetableKernel(scratch, numSamples);
+    else
+        sineKernel(scratch, numSamples);
+
+    juce::FloatVectorOperations::addWithMultiply(output, scratch, amplitudes[v], numSamples);
+}
+
+void VoiceBank::sineKernel(float* data, int numSamples) noexcept
+{
+    // Two-pass parabolic approximation: y = 4t(1 - |t|), then y += p * (y|y| - y), t = 2 * phase
+    const auto two = SIMDFloat::expand(2.0f);
+    const auto four = SIMDFloat::expand(4.0f);
+    const auto precision = SIMDFloat::expand(kSinePrecision);
+    constexpr int width = static_cast<int>(SIMDFloat::SIMDNumElements);
+
+    int i = 0;
+    for (; i + width <= numSamples; i += width)
+    {
+        const auto t = SIMDFloat::fromRawArray(data + i) * two;
+        auto y = four * (t - t * SIMDFloat::abs(t));
+        y = precision * (y * SIMDFloat::abs(y) - y) + y;
+        y.copyToRawArray(data + i);
+    }
+
+    for (; i < numSamples; ++i)
+        data[i] = sineApprox(data[i]);
+}
+
+float VoiceBank::sineApprox(float phase) noexcept
+{
+    const float t = phase * 2.0f;
+    const float y = 4.0f * (t - t * std::abs(t));
+    return kSinePrecision * (y * std::abs(y) - y) + y;
+}
+
+void VoiceBank::wavetableKernel(float* data, int numSamples) const noexcept
+{
+    constexpr float tableScale = static_cast<float>(kWavetableSize);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // Phase in [-0.5, 0.5) maps onto table positions [0, kWavetableSize)
+        const float position = (data[i] + 0.5f) * tableScale;
+        const int index = juce::jlimit(0, kWavetableSize - 1, static_cast<int>(position));
+        const float fraction = position - static_cast<float>(index);
+        const float a = wavetable[static_cast<size_t>(index)];
+        const float b = wavetable[static_cast<size_t>(index) + 1];
+        data[i] = a + fraction * (b - a);
+    }
+}
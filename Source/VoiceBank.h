@@ -0,0 +1,101 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Common.h"
+#include "VoiceAllocator.h"
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Block-rendering sine oscillator bank
+ *
+ * Oscillator state is kept in structure-of-arrays form. Each active voice
+ * renders a whole block into an aligned scratch buffer, either with a
+ * vectorised sine kernel or by interpolated wavetable lookup, and is mixed
+ * into the output with FloatVectorOperations.
+ */
+class VoiceBank {
+public:
+    static constexpr int kMaxVoices = VoiceAllocator::kMaxVoices;
+    static constexpr int kDefaultNumVoices = 16;
+    static constexpr int kNumMidiNotes = 128;
+    static constexpr int kWavetableSize = 2048;
+
+    VoiceBank();
+
+    // Allocates scratch space; call from prepareToPlay, never from the audio thread
+    void prepare(double newSampleRate, int maxBlockSize);
+
+    // Oscillator mode, safe to change from any thread
+    void setOscillatorMode(OscillatorMode newMode) noexcept { mode.store(newMode, std::memory_order_relaxed); }
+    [[nodiscard]] OscillatorMode getOscillatorMode() const noexcept { return mode.load(std::memory_order_relaxed); }
+
+    // Polyphony; resets every voice, so only call while not rendering
+    void setNumVoices(int newNumVoices) noexcept;
+    [[nodiscard]] int getNumVoices() const noexcept { return allocator.getNumVoices(); }
+
+    // Voice stealing, safe to change from any thread
+    void setStealingPolicy(VoiceStealingPolicy policy) noexcept { allocator.setStealingPolicy(policy); }
+    [[nodiscard]] VoiceStealingPolicy getStealingPolicy() const noexcept { return allocator.getStealingPolicy(); }
+
+    // Note control, constant time; source is from VoiceAllocator::getLiveSource()
+    // or getSequencerSource(), and a note-off only ends that source's voices
+    int noteOn(int source, int midiNote, float velocity) noexcept;
+    void noteOff(int source, int midiNote) noexcept;
+    void stopAll() noexcept;
+
+    [[nodiscard]] bool isVoiceActive(int index) const noexcept {
+        return (activeMask[static_cast<size_t>(index) / 64] >> (static_cast<size_t>(index) % 64)) & 1;
+    }
+    [[nodiscard]] bool hasActiveVoices() const noexcept;
+    [[nodiscard]] int getVoiceNote(int index) const noexcept { return notes[static_cast<size_t>(index)]; }
+
+    /**
+     * @brief Adds all active voices into output
+     *
+     * Leaves output untouched when no voice is active.
+     * @param output Mono destination, numSamples long
+     * @param numSamples Number of samples to render
+     */
+    void renderBlock(float* output, int numSamples) noexcept;
+
+private:
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+
+    // Converts phases in [-0.5, 0.5) to sin(2 * pi * phase), in place
+    static void sineKernel(float* data, int numSamples) noexcept;
+    static float sineApprox(float phase) noexcept;
+    void wavetableKernel(float* data, int numSamples) const noexcept;
+    void renderVoice(size_t v, float* output, int numSamples, bool useWavetable) noexcept;
+
+    void updatePhaseIncrements() noexcept;
+    void startVoice(int index, int midiNote, float velocity) noexcept;
+    void stopVoice(int index) noexcept;
+
+    VoiceAllocator allocator{kDefaultNumVoices};
+
+    // Structure-of-arrays oscillator state
+    std::array<float, kMaxVoices> phases{};       // Cycles, wrapped to [-0.5, 0.5)
+    std::array<float, kMaxVoices> increments{};   // Cycles per sample
+    std::array<float, kMaxVoices> amplitudes{};
+    std::array<int, kMaxVoices> notes{};
+
+    // One bit per voice; rendering walks the set bits only
+    std::array<juce::uint64, kMaxVoices / 64> activeMask{};
+    static_assert(kMaxVoices % 64 == 0, "Active mask assumes whole 64-bit words");
+
+    // Per-note phase increments, rebuilt only when the sample rate changes
+    std::array<float, kNumMidiNotes> phaseIncrements{};
+
+    // One sine cycle starting at phase -0.5, plus a guard point for interpolation
+    std::array<float, kWavetableSize + 1> wavetable{};
+
+    std::atomic<OscillatorMode> mode{OscillatorMode::Polynomial};
+
+    juce::HeapBlock<float> scratchStorage;
+    float* scratch{nullptr};
+    int scratchSize{0};
+    float sampleRate{0.0f};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoiceBank)
+};
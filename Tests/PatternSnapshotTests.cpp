@@ -0,0 +1,50 @@
+#include <JuceHeader.h>
+#include "PatternSnapshot.h"
+
+class PatternSnapshotTests : public juce::UnitTest {
+public:
+    PatternSnapshotTests() : juce::UnitTest("Pattern snapshot", "GrooveSequencer") {}
+
+    void runTest() override
+    {
+        beginTest("An oversized pattern keeps its earliest notes");
+        {
+            // Authored latest first, so capping in authoring order would keep the wrong end
+            const int numNotes = CompiledPattern::kMaxNotes + 40;
+            std::vector<Note> notes;
+            for (int step = numNotes - 1; step >= 0; --step)
+                notes.emplace_back(60, 100.0f, step * 0.25f, 0.25f);
+
+            Pattern pattern(PatternConstants::MAX_LENGTH);
+            pattern.setNotes(std::move(notes));
+            expect(pattern.check().error == ValidationError::TooManyNotes);
+
+            auto compiled = std::make_unique<CompiledPattern>();
+            expectEquals(compiled->compileFrom(pattern), 40);
+            expectEquals(compiled->numSteps, CompiledPattern::kMaxNotes);
+            expectEquals(static_cast<int>(compiled->positions[0]), 0);
+
+            for (int event = 1; event < compiled->numEvents; ++event)
+                expect(compiled->positions[static_cast<size_t>(event)] > compiled->positions[static_cast<size_t>(event - 1)]);
+
+            const auto lastStart = (CompiledPattern::kMaxNotes - 1) * CompiledPattern::kUnitsPerStep;
+            expectEquals(static_cast<juce::int64>(compiled->positions[static_cast<size_t>(compiled->numEvents - 1)]), lastStart);
+        }
+
+        beginTest("Chord notes keep their authoring order");
+        {
+            Pattern pattern(4);
+            pattern.setNotes({ Note(64, 100.0f, 1.0f, 0.25f), Note(60, 100.0f, 1.0f, 0.25f), Note(67, 100.0f, 0.5f, 0.25f) });
+
+            auto compiled = std::make_unique<CompiledPattern>();
+            expectEquals(compiled->compileFrom(pattern), 0);
+            expectEquals(compiled->numEvents, 4);
+            expectEquals(static_cast<int>(compiled->noteIndices[0]), -1);
+            expectEquals(static_cast<int>(compiled->noteIndices[1]), 2);
+            expectEquals(static_cast<int>(compiled->noteIndices[2]), 0);
+            expectEquals(static_cast<int>(compiled->noteIndices[3]), 1);
+        }
+    }
+};
+
+static PatternSnapshotTests patternSnapshotTests;
@@ -0,0 +1,94 @@
+#include <JuceHeader.h>
+#include "PatternDeltaCodec.h"
+#include "PatternTransformer.h"
+#include <limits>
+
+namespace {
+    bool roundTrip(const Pattern& pattern, Pattern& restored, ValidationReport& report)
+    {
+        juce::MemoryOutputStream out;
+        PatternDeltaCodec::write(pattern, out);
+        PatternFormat::ByteReader reader(out.getData(), out.getDataSize());
+        return PatternDeltaCodec::read(reader, restored, report);
+    }
+
+    // Sixteenth notes that fill a 16-beat pattern exactly, so anything appended runs past its end
+    Pattern makeFullPattern()
+    {
+        std::vector<Note> notes;
+        for (int step = 0; step < 64; ++step)
+            notes.emplace_back(60 + step % 5, 100.0f, step * 0.25f, 0.25f);
+
+        Pattern pattern(16);
+        pattern.setNotes(std::move(notes));
+        return pattern;
+    }
+}
+
+class PatternStateTests : public juce::UnitTest {
+public:
+    PatternStateTests() : juce::UnitTest("Pattern state", "GrooveSequencer") {}
+
+    void runTest() override
+    {
+        PatternTransformer transformer;
+        const auto source = makeFullPattern();
+
+        for (const auto type : { TransformationType::StepUp, TransformationType::Mirror,
+                                 TransformationType::RandomRhythmic })
+        {
+            beginTest("Transformed pattern survives a state round trip: "
+                      + juce::String(PTLogger::transformationTypeToString(type)));
+
+            const auto transformed = transformer.transformPattern(source, type);
+            expect(transformed.validate(), "Transformed pattern should hold all of its notes");
+            expectEquals(transformed.getTempo(), source.getTempo());
+            expectEquals(transformed.getGridSize(), source.getGridSize());
+
+            Pattern restored;
+            ValidationReport report;
+            const bool restoredOk = roundTrip(transformed, restored, report);
+            expect(restoredOk, report.describe());
+            expectEquals(restored.getLength(), transformed.getLength());
+            expect(restored.getNotes() == transformed.getNotes());
+        }
+
+        beginTest("State keeps notes that run past the pattern's length");
+        {
+            auto pattern = makeFullPattern();
+            pattern.getNotes().back().duration = 1.0f;
+            expect(!pattern.validate());
+
+            Pattern restored;
+            ValidationReport report;
+            const bool restoredOk = roundTrip(pattern, restored, report);
+            expect(restoredOk, report.describe());
+            expect(restored.getNotes() == pattern.getNotes());
+        }
+
+        beginTest("State rejects notes with non-finite times");
+        {
+            auto pattern = makeFullPattern();
+            pattern.getNotes()[3].startTime = std::numeric_limits<float>::quiet_NaN();
+
+            Pattern restored;
+            ValidationReport report;
+            expect(!roundTrip(pattern, restored, report));
+            expect(report.error == ValidationError::InvalidStartTime);
+        }
+    }
+};
+
+static PatternStateTests patternStateTests;
+
+int main()
+{
+    juce::UnitTestRunner runner;
+    runner.runAllTests();
+
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult(i)->failures;
+
+    return failures > 0 ? 1 : 0;
+}